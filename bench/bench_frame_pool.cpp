@@ -0,0 +1,83 @@
+// Runs frames through a four stage pipeline fed by a FramePool, the way ObjectDetector::run does,
+// and checks the pool makes no allocation after its preallocation.
+// usage: bench_frame_pool [num_frames] [width] [height]
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "pipeline.h"
+
+using namespace GLCC;
+
+typedef struct bench_packet {
+    long frame_id=0;
+    std::vector<unsigned char> frame;
+    std::vector<int> objects;
+} bench_packet_t;
+
+int main(int argc, char ** argv) {
+    loguru::g_stderr_verbosity = loguru::Verbosity_WARNING;
+    const long num_frames = argc > 1 ? atol(argv[1]) : 5000;
+    const int width = argc > 2 ? atoi(argv[2]) : 1280;
+    const int height = argc > 3 ? atoi(argv[3]) : 720;
+    const size_t frame_size = (size_t)width * height * 3;
+    const int queue_size = 2;
+
+    FramePool<bench_packet_t> frame_pool(4 * (queue_size + 1), [&](bench_packet_t * packet) {
+        packet->frame.resize(frame_size);
+        packet->objects.reserve(64);
+    });
+    FramePipeline<bench_packet_t> pipeline(
+        [&]() { return frame_pool.acquire(); },
+        [&](bench_packet_t * packet) { frame_pool.release(packet); });
+
+    long frame_id = 0;
+    pipeline.add_stage("decode", [&](bench_packet_t * packet) {
+        if (frame_id == num_frames) {
+            return (int)STAGE_STOP;
+        }
+        const unsigned char * frame_data = packet->frame.data();
+        packet->frame.resize(frame_size);
+        if (packet->frame.data() != frame_data) {
+            frame_pool.count_allocation();
+        }
+        memset(packet->frame.data(), (int)(frame_id & 0xff), frame_size);
+        packet->frame_id = frame_id++;
+        return (int)STAGE_PASS;
+    }, queue_size, BLOCK_DROP);
+    pipeline.add_stage("infer", [&](bench_packet_t * packet) {
+        packet->objects.clear();
+        for (int i = 0; i < (int)(packet->frame_id % 64); i++) {
+            packet->objects.emplace_back(packet->frame[i]);
+        }
+        return (int)STAGE_PASS;
+    }, queue_size, BLOCK_DROP);
+    pipeline.add_stage("annotate", [&](bench_packet_t * packet) {
+        for (int object : packet->objects) {
+            packet->frame[object] = 0xff;
+        }
+        return (int)STAGE_PASS;
+    }, queue_size, BLOCK_DROP);
+    uint64_t checksum = 0;
+    pipeline.add_stage("push", [&](bench_packet_t * packet) {
+        checksum += packet->frame[frame_size / 2];
+        return (int)STAGE_PASS;
+    }, queue_size, BLOCK_DROP);
+
+    auto start_time = std::chrono::steady_clock::now();
+    int ret = pipeline.run();
+    const double second = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    printf("frames: %ld (%dx%d), %.1f fps, checksum: %lu\n", num_frames, width, height,
+        num_frames / second, (unsigned long)checksum);
+    for (size_t i = 0; i < pipeline.get_num_stages(); i++) {
+        printf("  %-8s processed: %lu, dropped: %lu\n", pipeline.get_stage_name(i).c_str(),
+            (unsigned long)pipeline.get_num_processed(i), (unsigned long)pipeline.get_num_dropped(i));
+    }
+    printf("pool size: %lu, allocations after preallocation: %lu\n",
+        (unsigned long)frame_pool.get_size(), (unsigned long)frame_pool.get_num_allocations());
+    if (ret == -1 || frame_pool.get_num_allocations() != 0) {
+        printf("FAIL: the steady state allocated\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+// Compares LatticeCache::locate against the pointPolygonTest loop it replaced, on random
+// star shaped zones and object centers, and checks both find the same occupied zones.
+// usage: bench_lattice [num_zones] [num_objects] [num_frames]
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "lattice.h"
+
+using namespace GLCC;
+
+int main(int argc, char ** argv) {
+    loguru::g_stderr_verbosity = loguru::Verbosity_WARNING;
+    const int num_zones = argc > 1 ? atoi(argv[1]) : 48;
+    const int num_objects = argc > 2 ? atoi(argv[2]) : 64;
+    const int num_frames = argc > 3 ? atoi(argv[3]) : 2000;
+    const cv::Size frame_size(1920, 1080);
+
+    std::mt19937 rng(20);
+    std::uniform_real_distribution<float> uniform(0, 1);
+    contour_list_t contour_list;
+    for (int i = 0; i < num_zones; i++) {
+        const cv::Point2f origin(uniform(rng) * frame_size.width, uniform(rng) * frame_size.height);
+        const float radius = 40 + uniform(rng) * 160;
+        const int num_vertices = 6 + (int)(uniform(rng) * 7);
+        std::vector<cv::Point> contour;
+        for (int j = 0; j < num_vertices; j++) {
+            const float angle = 2 * CV_PI * j / num_vertices;
+            const float r = radius * (0.5f + 0.5f * uniform(rng));
+            contour.emplace_back(origin.x + r * cos(angle), origin.y + r * sin(angle));
+        }
+        contour_list["zone_" + std::to_string(i)] = contour;
+    }
+    // a few frames of centers, some of them off the frame
+    std::vector<std::vector<cv::Point>> frames(64);
+    for (auto & centers : frames) {
+        for (int i = 0; i < num_objects; i++) {
+            centers.emplace_back(uniform(rng) * frame_size.width * 1.02f - 10, uniform(rng) * frame_size.height * 1.02f - 10);
+        }
+    }
+
+    LatticeCache cache;
+    cache.build(contour_list, frame_size, 1);
+    std::vector<std::vector<cv::Point>> contours(cache.size());
+    for (int zone_id = 0; zone_id < cache.size(); zone_id++) {
+        contours[zone_id] = cache.get_zone(zone_id).contours[0];
+    }
+
+    // the loop before the cell index: every zone against every center
+    std::vector<uint8_t> expected(cache.size());
+    long num_occupied = 0;
+    auto start_time = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < num_frames; frame++) {
+        const std::vector<cv::Point> & centers = frames[frame % frames.size()];
+        for (int zone_id = 0; zone_id < cache.size(); zone_id++) {
+            expected[zone_id] = 0;
+            for (auto & center : centers) {
+                if (cv::pointPolygonTest(contours[zone_id], center, false) >= 0) {
+                    expected[zone_id] = 1;
+                    break;
+                }
+            }
+            num_occupied += expected[zone_id];
+        }
+    }
+    const double polygon_second = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    start_time = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < num_frames; frame++) {
+        cache.locate(frames[frame % frames.size()]);
+        for (int zone_id = 0; zone_id < cache.size(); zone_id++) {
+            num_occupied -= cache.is_occupied(zone_id);
+        }
+    }
+    const double locate_second = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    printf("zones: %d, objects: %d, frames: %d\n", num_zones, num_objects, num_frames);
+    printf("  pointPolygonTest: %.2f us per frame\n", polygon_second * 1e6 / num_frames);
+    printf("  locate:           %.2f us per frame, %.1fx\n", locate_second * 1e6 / num_frames, polygon_second / locate_second);
+
+    int num_mismatches = 0;
+    for (size_t frame = 0; frame < frames.size(); frame++) {
+        cache.locate(frames[frame]);
+        for (int zone_id = 0; zone_id < cache.size(); zone_id++) {
+            bool is_occupied = false;
+            for (auto & center : frames[frame]) {
+                is_occupied = is_occupied || cv::pointPolygonTest(contours[zone_id], center, false) >= 0;
+            }
+            num_mismatches += is_occupied != cache.is_occupied(zone_id);
+        }
+    }
+    if (num_mismatches != 0 || num_occupied != 0) {
+        printf("FAIL: %d zones located differently\n", num_mismatches);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,138 @@
+// Compares Router::find against the regex chain it replaced, on the routes GLCCServer registers,
+// and checks both pick the same handler.
+// usage: bench_router [num_requests]
+#include <cstdio>
+#include <cstdlib>
+#include "router.h"
+
+using namespace GLCC;
+
+typedef struct bench_route {
+    std::string method;
+    std::string path;
+    bool is_prefix;
+} bench_route_t;
+
+static const std::vector<bench_route_t> main_routes = {
+    {"GET", "/hello_world", false}, {"POST", "/login", true}, {"POST", "/register", false},
+};
+static const std::vector<bench_route_t> login_routes = {
+    {"POST", "/login/dect_video", false}, {"POST", "/login/disdect_video", false},
+    {"POST", "/login/register_video", false}, {"POST", "/login/delete_video", false},
+    {"POST", "/login/put_lattice", false}, {"POST", "/login/disput_lattice", false},
+    {"POST", "/login/delete_video_file", false}, {"POST", "/login/fetch_video_file", false},
+    {"POST", "/login/dect_video_file", false}, {"POST", "/login/kick_dect_video_file", false},
+    {"POST", "/login/transmiss_video_file", false},
+};
+
+// what REGEX_FUNC did for every route on every request, both regexes built in place
+static bool regex_match(const std::string & method, const std::string & uri, const bench_route_t & route) {
+    std::regex method_regex("^" + route.method + "$", std::regex_constants::icase);
+    std::regex uri_regex(route.is_prefix ? route.path + ".*" : route.path);
+    bool is_method = std::regex_match(method, method_regex);
+    bool is_uri = std::regex_match(uri, uri_regex);
+    return is_method && is_uri;
+}
+
+// returns the index of the last matching route as the macros fell through all of them, -1 if none
+static int regex_dispatch(const std::string & method, const std::string & uri) {
+    int matched = -1;
+    for (int i = 0; i < (int)main_routes.size(); i++) {
+        if (regex_match(method, uri, main_routes[i])) {
+            matched = i;
+        }
+    }
+    if (matched == 1) {
+        matched = -1;
+        for (int i = 0; i < (int)login_routes.size(); i++) {
+            if (regex_match(method, uri, login_routes[i])) {
+                matched = main_routes.size() + i;
+            }
+        }
+    }
+    return matched;
+}
+
+int main(int argc, char ** argv) {
+    loguru::g_stderr_verbosity = loguru::Verbosity_WARNING;
+    const int num_requests = argc > 1 ? atoi(argv[1]) : 20000;
+
+    // the handlers only return their index, so both sides can be compared
+    int routed = -1;
+    Router main_router;
+    Router login_router;
+    for (int i = 0; i < (int)main_routes.size(); i++) {
+        route_func_t func = [&routed, i](WFHttpTask *, void *) { routed = i; };
+        if (main_routes[i].is_prefix) {
+            main_router.add_prefix(main_routes[i].method, main_routes[i].path, func);
+        } else {
+            main_router.add(main_routes[i].method, main_routes[i].path, func);
+        }
+    }
+    for (int i = 0; i < (int)login_routes.size(); i++) {
+        const int index = main_routes.size() + i;
+        login_router.add(login_routes[i].method, login_routes[i].path, [&routed, index](WFHttpTask *, void *) { routed = index; });
+    }
+    auto router_dispatch = [&](const std::string & method, const std::string & uri) {
+        routed = -1;
+        const route_func_t * func = main_router.find(method, uri);
+        if (func != nullptr) {
+            (*func)(nullptr, nullptr);
+        }
+        if (routed == 1) {
+            routed = -1;
+            func = login_router.find(method, uri);
+            if (func != nullptr) {
+                (*func)(nullptr, nullptr);
+            }
+        }
+        return routed;
+    };
+
+    std::vector<std::pair<std::string, std::string>> requests;
+    for (auto & route : main_routes) {
+        if (!route.is_prefix) {
+            requests.emplace_back(route.method, route.path);
+        }
+    }
+    for (auto & route : login_routes) {
+        requests.emplace_back(route.method, route.path);
+    }
+    requests.emplace_back("post", "/login/dect_video");
+    requests.emplace_back("GET", "/login/dect_video");
+    requests.emplace_back("POST", "/login/unknown");
+    requests.emplace_back("GET", "/unknown");
+
+    int num_mismatches = 0;
+    for (auto & request : requests) {
+        const int expected = regex_dispatch(request.first, request.second);
+        const int actual = router_dispatch(request.first, request.second);
+        if (expected != actual) {
+            printf("  %s %s: regex %d, router %d\n", request.first.c_str(), request.second.c_str(), expected, actual);
+            num_mismatches++;
+        }
+    }
+
+    long checksum = 0;
+    auto start_time = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_requests; i++) {
+        auto & request = requests[i % requests.size()];
+        checksum += regex_dispatch(request.first, request.second);
+    }
+    const double regex_second = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    start_time = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_requests; i++) {
+        auto & request = requests[i % requests.size()];
+        checksum -= router_dispatch(request.first, request.second);
+    }
+    const double router_second = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    printf("routes: %d, requests: %d\n", (int)(main_routes.size() + login_routes.size()), num_requests);
+    printf("  regex:  %.3f us per request\n", regex_second * 1e6 / num_requests);
+    printf("  router: %.3f us per request, %.1fx\n", router_second * 1e6 / num_requests, regex_second / router_second);
+    if (num_mismatches != 0 || checksum != 0) {
+        printf("FAIL: %d requests routed differently\n", num_mismatches);
+        return 1;
+    }
+    return 0;
+}
@@ -17,6 +17,9 @@ public:
 	~BYTETracker();
 
 	vector<STrack> update(const vector<Object>& objects);
+	// advance the tracks by the kalman filter only, for the frames without detections,
+	// a static frame holds the tracks in place instead of carrying their velocities on
+	vector<STrack> predict(bool is_static = false);
 	Scalar get_color(int idx);
 
 private:
@@ -47,4 +50,4 @@ private:
 	vector<STrack> lost_stracks;
 	vector<STrack> removed_stracks;
 	byte_kalman::KalmanFilter kalman_filter;
-};
\ No newline at end of file
+};
\ No newline at end of file
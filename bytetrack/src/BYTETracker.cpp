@@ -238,4 +238,52 @@ vector<STrack> BYTETracker::update(const vector<Object>& objects)
 		}
 	}
 	return output_stracks;
-}
\ No newline at end of file
+}
+
+vector<STrack> BYTETracker::predict(bool is_static)
+{
+	this->frame_id++;
+	vector<STrack*> tracked_stracks;
+	vector<STrack*> strack_pool;
+	vector<STrack> output_stracks;
+
+	// age the lost tracks out as update does, they would live on through a long static scene
+	vector<STrack> lost_stracks_swap;
+	for (int i = 0; i < this->lost_stracks.size(); i++)
+	{
+		if (this->frame_id - this->lost_stracks[i].end_frame() > this->max_time_lost)
+		{
+			this->lost_stracks[i].mark_removed();
+			this->removed_stracks.push_back(this->lost_stracks[i]);
+		}
+		else
+		{
+			lost_stracks_swap.push_back(this->lost_stracks[i]);
+		}
+	}
+	this->lost_stracks.swap(lost_stracks_swap);
+
+	for (int i = 0; i < this->tracked_stracks.size(); i++)
+	{
+		tracked_stracks.push_back(&this->tracked_stracks[i]);
+	}
+	strack_pool = joint_stracks(tracked_stracks, this->lost_stracks);
+	if (is_static)
+	{
+		// nothing moved since the last detection, stop the boxes drifting off the objects
+		for (int i = 0; i < strack_pool.size(); i++)
+		{
+			strack_pool[i]->mean.tail<4>().setZero();
+		}
+	}
+	STrack::multi_predict(strack_pool, this->kalman_filter);
+
+	for (int i = 0; i < this->tracked_stracks.size(); i++)
+	{
+		if (this->tracked_stracks[i].is_activated)
+		{
+			output_stracks.push_back(this->tracked_stracks[i]);
+		}
+	}
+	return output_stracks;
+}
\ No newline at end of file
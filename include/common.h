@@ -13,10 +13,12 @@
 #include <glob.h>
 #include <string.h>
 #include <vector>
+#include <algorithm>
 #include <array>
 #include <string>
 #include <regex>
 #include <functional>
+#include <memory>
 #include <unordered_map>
 #include <mutex>
 #include <chrono>
@@ -43,17 +45,49 @@ namespace GLCC {
         extern const long num_millisecond_per_second;
         extern const long num_microsecond_per_second;
         extern const long num_second_per_minute;
+        extern const long num_second_per_day;
 
-        extern long long interval_to_watch_detector_second;
-        extern long long interval_to_watch_file_second;
+        extern long expiry_load_window_second;
+        extern size_t expiry_max_delete_rows;
         extern long max_detector_live_day;
         extern long max_video_file_save_day;
 
+        extern int max_inference_batch_size;
+        extern long max_inference_wait_microsecond;
+        extern bool inference_preload;
+        extern int inference_warmup_width;
+        extern int inference_warmup_height;
+        extern int inference_num_warmups;
+
+        extern int thumbnail_num_workers;
+        extern long thumbnail_queue_size;
+        extern int thumbnail_policy;
+        extern long thumbnail_wait_millisecond;
+
+        extern size_t transmiss_chunk_size;
+        extern size_t transmiss_num_chunks;
+        extern size_t transmiss_max_range_chunks;
+
+        extern int session_num_shards;
+        extern long session_max_sessions;
+        extern long session_ttl_second;
+
+        extern int executor_num_workers;
+        extern int executor_pin_policy;
+        extern std::vector<int> executor_cpus;
+
+        extern double scheduler_rooms_per_core;
+        extern double scheduler_max_utilization;
+        extern long scheduler_default_cost_microsecond;
+        extern int scheduler_min_fps;
+        extern int scheduler_default_target_fps;
+        extern size_t scheduler_queue_size;
+        extern long scheduler_rebalance_second;
+
         extern std::string file_time_format;
         extern std::string livego_check_stat_template;
         extern std::string livego_push_url_template;
         extern std::string livego_kick_url;
-        extern std::string ffmpeg_push_command;
         extern std::string ffmpeg_file_push_command;
         extern std::string video_path_template;
 
@@ -63,6 +97,8 @@ namespace GLCC {
 
         extern std::string mysql_root_url;
         extern std::string mysql_glccserver_url;
+        extern long write_behind_flush_millisecond;
+        extern size_t write_behind_max_batch_rows;
     }
 
     typedef struct ssl_context {
@@ -97,10 +133,13 @@ namespace GLCC {
         int device_id=0; // 0
     } detector_init_context_t;
 
+    struct room_quota;
+
     typedef struct detector_run_context {
         std::string video_path; // video to be sampled
         std::string upload_path; // rtmp to be load
         Json::Value vis_params;
+        std::shared_ptr<room_quota> quota; // fps assigned by the scheduler, none runs at the source rate
     } detector_run_context_t;
 
     typedef struct glcc_server_context {
@@ -119,16 +158,22 @@ namespace GLCC {
         Json::Value extra_info;
     } glcc_server_context_t;
 
+    // Registry of named products split into shards by the hash of the name. Each shard publishes
+    // an immutable map through std::atomic_load/atomic_store of a shared_ptr, so GetProduct never
+    // takes the shard mutex the registrations and erasures copy the map under. It is not lock-free:
+    // libstdc++ guards those calls with a pool of mutexes picked by address, held for a pointer copy.
+    // A product handed out stays alive until its last holder drops it, even once erased.
     template <class ProductType_t>
     class ProductFactory
     {
         public:
+            typedef std::shared_ptr<ProductType_t> product_ptr_t;
+
             // delete all copy 
             ProductFactory(const ProductFactory &) = delete;
             ProductFactory(const ProductFactory &&) = delete;
             const ProductFactory& operator=(const ProductFactory &) = delete;
             const ProductFactory& operator=(const ProductFactory &&) = delete;
-            static std::mutex lock;
 
             static ProductFactory<ProductType_t> &Instance() {
                 static ProductFactory<ProductType_t> instance;
@@ -139,44 +184,94 @@ namespace GLCC {
                 return &Instance();
             }
 
-            void RegisterProduct(const std::string & name, ProductType_t *registrar)
+            void RegisterProduct(const std::string & name, product_ptr_t registrar)
             {
-                std::lock_guard<std::mutex> lock_guard(lock);
-                m_ProductRegistry[name] = registrar;
+                shard_t & shard = get_shard(name);
+                std::lock_guard<std::mutex> lock_guard(shard.lock);
+                std::shared_ptr<registry_t> registry = std::make_shared<registry_t>(*std::atomic_load(&shard.registry));
+                (*registry)[name] = std::move(registrar);
+                std::atomic_store(&shard.registry, registry_ptr_t(std::move(registry)));
             }
 
-            void RegisterProduct(const std::string & name, std::function<ProductType_t* (void *)> init_func, void * init_args)
+            // init_func runs only if name is free and out of the shard lock, is_created tells the one call
+            // whose product got registered, the others get the existing one and theirs is dropped
+            product_ptr_t RegisterProduct(const std::string & name, std::function<ProductType_t* (void *)> init_func, 
+                                          void * init_args, bool * is_created = nullptr)
             {
-                std::lock_guard<std::mutex> lock_guard(lock);
-                m_ProductRegistry[name] = init_func(init_args);
+                if (is_created != nullptr) {
+                    *is_created = false;
+                }
+                product_ptr_t existing = GetProduct(name);
+                if (existing != nullptr) {
+                    return existing;
+                }
+                product_ptr_t product(init_func(init_args));
+                if (product == nullptr) {
+                    return nullptr;
+                }
+                shard_t & shard = get_shard(name);
+                {
+                    std::lock_guard<std::mutex> lock_guard(shard.lock);
+                    registry_ptr_t current = std::atomic_load(&shard.registry);
+                    auto iter = current->find(name);
+                    if (iter != current->end()) {
+                        existing = iter->second;
+                    } else {
+                        std::shared_ptr<registry_t> registry = std::make_shared<registry_t>(*current);
+                        (*registry)[name] = product;
+                        std::atomic_store(&shard.registry, registry_ptr_t(std::move(registry)));
+                    }
+                }
+                if (existing != nullptr) {
+                    // another call registered name meanwhile, ours is released out of the lock
+                    return existing;
+                }
+                if (is_created != nullptr) {
+                    *is_created = true;
+                }
+                return product;
             }
 
-            int EraseProductDel(const std::string & name) {
-                std::lock_guard<std::mutex> lock_guard(lock);
-                if (m_ProductRegistry.find(name) != m_ProductRegistry.end()) {
-                    ProductType_t * elem = m_ProductRegistry[name];
-                    int n = m_ProductRegistry.erase(name);
-                    delete elem;
-                    return n;
+            int EraseProduct(const std::string & name) {
+                shard_t & shard = get_shard(name);
+                std::lock_guard<std::mutex> lock_guard(shard.lock);
+                registry_ptr_t current = std::atomic_load(&shard.registry);
+                if (current->find(name) == current->end()) {
+                    return 0;
                 }
-                return m_ProductRegistry.erase(name);
+                std::shared_ptr<registry_t> registry = std::make_shared<registry_t>(*current);
+                int n = registry->erase(name);
+                std::atomic_store(&shard.registry, registry_ptr_t(std::move(registry)));
+                return n;
             }
-            int EraseProduct(const std::string & name) {
-                std::lock_guard<std::mutex> lock_guard(lock);
-                return m_ProductRegistry.erase(name);
+
+            // erases name only while it still holds product, so a stale caller can't erase its successor
+            int EraseProduct(const std::string & name, const product_ptr_t & product) {
+                shard_t & shard = get_shard(name);
+                std::lock_guard<std::mutex> lock_guard(shard.lock);
+                registry_ptr_t current = std::atomic_load(&shard.registry);
+                auto iter = current->find(name);
+                if (iter == current->end() || iter->second != product) {
+                    return 0;
+                }
+                std::shared_ptr<registry_t> registry = std::make_shared<registry_t>(*current);
+                int n = registry->erase(name);
+                std::atomic_store(&shard.registry, registry_ptr_t(std::move(registry)));
+                return n;
             }
 
-            ProductType_t *GetProduct(const std::string & name)
+            product_ptr_t GetProduct(const std::string & name)
             {
-                std::lock_guard<std::mutex> lock_guard(lock);
-                if (m_ProductRegistry.find(name) != m_ProductRegistry.end())
+                registry_ptr_t registry = std::atomic_load(&get_shard(name).registry);
+                auto iter = registry->find(name);
+                if (iter != registry->end())
                 {
-                    return m_ProductRegistry[name];
+                    return iter->second;
                 }
                 return nullptr;
             }
 
-            ProductType_t *GetProduct(const char * name)
+            product_ptr_t GetProduct(const char * name)
             {
                 std::string _name = name;
                 return GetProduct(_name);
@@ -186,11 +281,21 @@ namespace GLCC {
         ProductFactory() {}
         ~ProductFactory() {}
 
-        std::unordered_map<std::string, ProductType_t *> m_ProductRegistry;
-    };
+        typedef std::unordered_map<std::string, product_ptr_t> registry_t;
+        typedef std::shared_ptr<const registry_t> registry_ptr_t;
+
+        typedef struct shard {
+            std::mutex lock;
+            registry_ptr_t registry = std::make_shared<const registry_t>();
+        } shard_t;
 
-    template<class ProductType_t>
-    std::mutex ProductFactory<ProductType_t>::lock;
+        static const size_t num_shards = 16;
+        std::array<shard_t, num_shards> shards;
+
+        shard_t & get_shard(const std::string & name) {
+            return shards[std::hash<std::string>()(name) % num_shards];
+        }
+    };
 
 
     std::string get_now_time(const std::string & time_format) noexcept ;
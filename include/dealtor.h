@@ -1,34 +1,84 @@
 #ifndef _DEALTOR_H
 #define _DEALTOR_H
 #include <vector>
+#include <memory>
 #include <opencv2/opencv.hpp>
 #include <string>
 #include "loguru.hpp"
 #include "detector.h"
 #include "common.h"
+#include "pipeline.h"
+#include "inference.h"
+#include "gate.h"
+#include "encoder.h"
+#include "recorder.h"
+#include "lattice.h"
+#include "thumbnail.h"
+#include "lifecycle.h"
 #include "BYTETracker.h"
 
 
 namespace GLCC{
 
+    typedef struct frame_packet {
+        long frame_id=0;
+        cv::Mat frame;
+        std::vector<Object> objects;
+        bool is_dect=true; // false if a gate skipped the inference of this frame
+        bool is_static=false; // true if the motion gate skipped it, nothing moved
+        std::vector<cv::Point> centers; // centers of the shown objects, used by lattice
+        std::chrono::steady_clock::time_point capture_time;
+    } frame_packet_t;
+
+    typedef struct lattice_context {
+        int into_recoder_time_gap=0; // millisecond
+        int out_recoder_time_gap=0;
+        std::stringstream video_save_path;
+        ClipRecorder * recorder=nullptr;
+        bool is_recording=false;
+        bool is_cover_taken=false;
+        std::chrono::system_clock::time_point record_time_point;
+        LatticeCache lattice;
+        zone_state_t zone_state;
+    } lattice_context_t;
+
     class Detector {
         public:
-            std::atomic_int32_t state{0};
+            Lifecycle lifecycle;
             std::atomic_bool is_put_lattice{true};
-            std::mutex resource_lock;
-            std::unordered_map<std::string, std::vector<cv::Point>> contour_list;
             std::string resource_dir;
+            std::atomic<uint64_t> num_inferences{0};
+            std::atomic<uint64_t> num_skipped_inferences{0}; // between two detections
+            std::atomic<uint64_t> num_static_inferences{0}; // skipped by the motion gate
             virtual int run(
-                void * args, 
+                void * args,
                 std::function<void(void *)> cancel_func = nullptr,
                 std::function<void(void *)> deal_func = nullptr) = 0;
             virtual ~Detector() {}
+            // the writers copy the current snapshot, edit it and swap the new version in,
+            // the runner loads one snapshot per frame and rebuilds its lattice when the version moves
+            void set_contour(const std::string & name, const std::vector<cv::Point> & contour);
+            void set_contours(const contour_list_t & contours);
+            void erase_contour(const std::string & name);
+            std::shared_ptr<const contour_snapshot_t> get_contours() const;
         protected:
+            int put_lattice(cv::Mat & frame,
+                const std::vector<cv::Point> & centers,
+                lattice_context_t & context);
+            void release_lattice(lattice_context_t & context);
+            // called on the recorder thread once a clip is closed
+            static void make_cover(const std::string & clip_path, const cv::Mat & cover);
+        private:
+            // serializes the writers only, the runner never takes it
+            std::mutex contour_lock;
+            std::shared_ptr<const contour_snapshot_t> contour_snapshot = std::make_shared<const contour_snapshot_t>();
+
+            void update_contours(const std::function<void(contour_list_t &)> & edit);
     };
 
     class ObjectDetector: protected Detector {
         public:
-            ObjectDetector(const char * model_path, 
+            ObjectDetector(const char * model_path,
                             const char * device_name,
                             const int device_id);
             ObjectDetector(const std::string & model_path,
@@ -37,13 +87,20 @@ namespace GLCC{
             ~ObjectDetector();
             cv::Scalar get_color();
             int dect(cv::Mat & img, std::vector<Object> & objects, float score_thre);
-            int run(void * args, 
+            int run(void * args,
                 std::function<void(void *)> cancel_func = nullptr,
                 std::function<void(void *)> deal_func = nullptr) override;
 
             static Detector * init_func(void * init_args);
         protected:
-            mm_handle_t detector;
+            std::shared_ptr<InferenceEngine> engine;
+            std::vector<std::string> class_names;
+
+            virtual const char * get_name() const;
+            // called once the capture is opened, before the pipeline starts
+            virtual int prepare(const Json::Value & extra_config, const int fps);
+            // draw the packet and fill the centers of the objects to be put on lattice
+            virtual int annotate(frame_packet_t * packet);
     };
 
     class TrackerDetector: protected ObjectDetector {
@@ -58,10 +115,15 @@ namespace GLCC{
 
             int dect(cv::Mat & img, std::vector<Object> & objects, float score_thre);
 
-            int run(void * args, 
-                std::function<void(void *)> cancel_func = nullptr,
-                std::function<void(void *)> deal_func = nullptr) override;
             static Detector * init_func(void * init_args);
+        protected:
+            std::unique_ptr<BYTETracker> tracker;
+            float wh_ratio_thre_to_show=1.6;
+            float wh_multiply_thre_to_show=20;
+
+            const char * get_name() const override;
+            int prepare(const Json::Value & extra_config, const int fps) override;
+            int annotate(frame_packet_t * packet) override;
     };
 }
 
@@ -0,0 +1,62 @@
+#ifndef _ENCODER_H
+#define _ENCODER_H
+
+#include <string>
+#include <functional>
+#include <opencv2/opencv.hpp>
+#include "loguru.hpp"
+#include "common.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+}
+
+
+namespace GLCC {
+    // Encodes BGR frames to H.264 in process and muxes them to an FLV/RTMP url,
+    // replacing the rawvideo pipe to a forked ffmpeg.
+    class StreamEncoder {
+        public:
+            StreamEncoder(const StreamEncoder &) = delete;
+            const StreamEncoder& operator=(const StreamEncoder &) = delete;
+
+            StreamEncoder() {}
+            ~StreamEncoder();
+
+            // encoder_config: codec, preset, tune, threads, gop, bit_rate
+            int open(const std::string & url,
+                     const int width,
+                     const int height,
+                     const int fps,
+                     const Json::Value & encoder_config);
+            int write(const cv::Mat & frame);
+            // flushes the encoder and writes the trailer
+            void close();
+            bool is_opened() const { return format_context != nullptr; }
+
+            // called with every encoded packet, in the time base of the codec, before it is muxed
+            void set_packet_func(std::function<void(const AVPacket *)> packet_func) { this->packet_func = packet_func; }
+            const AVCodecParameters * get_codec_parameters() const { return stream->codecpar; }
+            AVRational get_time_base() const { return codec_context->time_base; }
+
+        private:
+            AVFormatContext * format_context = nullptr;
+            AVCodecContext * codec_context = nullptr;
+            AVStream * stream = nullptr;
+            SwsContext * sws_context = nullptr;
+            AVFrame * yuv_frame = nullptr;
+            AVPacket * packet = nullptr;
+            int64_t next_pts = 0;
+            std::string url;
+            std::function<void(const AVPacket *)> packet_func;
+
+            int encode(AVFrame * frame);
+            void release();
+    };
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef _EXECUTOR_H
+#define _EXECUTOR_H
+
+#include <deque>
+#include <thread>
+#include <condition_variable>
+#include <sched.h>
+#include <pthread.h>
+#include "loguru.hpp"
+#include "common.h"
+
+
+namespace GLCC {
+    // NO_PIN: the rooms run on any cpu; WORKER_PIN: worker i stays on cpus[i % n];
+    // ROOM_PIN: a room runs on cpus[hash(room_name) % n], on whatever worker takes it
+    enum PinPolicy {NO_PIN=0, WORKER_PIN=1, ROOM_PIN=2};
+
+    int parse_pin_policy(const std::string & policy) noexcept;
+
+    // Runs the detectors of the rooms on a pool of num_workers threads of its own, a room
+    // holds its worker until its detector returns, so the rooms never occupy the workflow
+    // compute threads left to the short go tasks. A room lives until it is stopped, so one
+    // submitted while every worker is busy is rejected rather than queued behind rooms that
+    // may never return, the scheduler keeps its rooms within num_workers. The pipeline
+    // threads of a room inherit the cpu affinity of its worker.
+    class DetectorExecutor {
+        public:
+            DetectorExecutor(const DetectorExecutor &) = delete;
+            DetectorExecutor(const DetectorExecutor &&) = delete;
+            const DetectorExecutor& operator=(const DetectorExecutor &) = delete;
+            const DetectorExecutor& operator=(const DetectorExecutor &&) = delete;
+
+            static DetectorExecutor & Instance() {
+                static DetectorExecutor instance;
+                return instance;
+            }
+
+            int init(const int num_workers, const int pin_policy, const std::vector<int> & cpus);
+            // drops the queued rooms and waits a while for the running ones, which have to be cancelled first
+            void release();
+
+            // returns -1 if no worker is free or the executor is released, done_func is called once
+            // func returned and its worker is free again
+            int submit(const std::string & room_name, std::function<void()> func, std::function<void()> done_func=nullptr);
+            std::vector<std::string> get_running_rooms();
+            int get_num_workers();
+
+        private:
+            DetectorExecutor() {}
+            ~DetectorExecutor() { release(); }
+
+            typedef struct room_job {
+                std::string room_name;
+                std::function<void()> func;
+                std::function<void()> done_func;
+            } room_job_t;
+
+            typedef struct worker {
+                std::thread thread;
+                std::string room_name; // empty while idle
+                bool exited = false;
+            } worker_t;
+
+            std::mutex lock;
+            std::condition_variable cond;
+            std::deque<room_job_t> jobs;
+            std::vector<std::unique_ptr<worker_t>> workers;
+            int pin_policy = NO_PIN;
+            std::vector<int> cpus;
+            cpu_set_t default_cpu_set;
+            bool stopping = false;
+
+            void run(const int index);
+            void pin(const int cpu);
+            void unpin();
+    };
+}
+
+#endif
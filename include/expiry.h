@@ -0,0 +1,85 @@
+#ifndef _EXPIRY_H
+#define _EXPIRY_H
+
+#include <queue>
+#include <thread>
+#include <condition_variable>
+#include "loguru.hpp"
+#include "common.h"
+
+
+namespace GLCC {
+    enum ExpiryKind {FILE_EXPIRY=0, ROOM_EXPIRY=1, NUM_EXPIRY_KINDS=2};
+
+    // a File or Room row due at end_second, name is its file_path or room_name
+    typedef struct expiry_entry {
+        long long end_second = 0;
+        int kind = FILE_EXPIRY;
+        std::string user_name;
+        std::string video_name;
+        std::string name;
+    } expiry_entry_t;
+
+    // gets the due entries of one kind, at most max_batch_rows at a time
+    typedef std::function<void (std::vector<expiry_entry_t> &&)> expiry_handler_t;
+    // queries the rows with from_second <= end_time < to_second and pushes them back,
+    // calls ExpiryService::retry_load(from_second) if the query fails
+    typedef std::function<void (long long from_second, long long to_second)> expiry_loader_t;
+
+    // Keeps the File and Room rows expiring within the next load_window_second in a min-heap
+    // ordered by end_time and hands them to their handler on one thread when they come due.
+    // The window is refilled by the loader with an end_time range query when half of it has
+    // passed, so unexpired rows beyond it are never read.
+    class ExpiryService {
+        public:
+            ExpiryService(const ExpiryService &) = delete;
+            ExpiryService(const ExpiryService &&) = delete;
+            const ExpiryService& operator=(const ExpiryService &) = delete;
+            const ExpiryService& operator=(const ExpiryService &&) = delete;
+
+            static ExpiryService & Instance() {
+                static ExpiryService instance;
+                return instance;
+            }
+
+            // the handlers and the loader are set before init, the first load starts at init
+            void set_handler(const int kind, expiry_handler_t handler);
+            void set_loader(expiry_loader_t loader);
+            int init(const long load_window_second, const size_t max_batch_rows);
+            void release();
+
+            // a later push of the same row replaces its end_second, entries past the loaded
+            // window are left to the load covering them
+            void push(expiry_entry_t && entry);
+            void retry_load(const long long from_second);
+
+        private:
+            ExpiryService() {}
+            ~ExpiryService() { release(); }
+
+            struct later_first {
+                bool operator()(const expiry_entry_t & a, const expiry_entry_t & b) const noexcept {
+                    return a.end_second > b.end_second;
+                }
+            };
+
+            std::mutex lock;
+            std::condition_variable cond;
+            std::priority_queue<expiry_entry_t, std::vector<expiry_entry_t>, later_first> entries;
+            // the end_second each queued row is due at, entries not matching it are stale
+            std::unordered_map<std::string, long long> due_seconds;
+            expiry_handler_t handlers[NUM_EXPIRY_KINDS];
+            expiry_loader_t loader;
+            std::thread worker;
+            long load_window_second = 3600;
+            size_t max_batch_rows = 64;
+            long long loaded_second = 0;
+            long long next_load_second = 0;
+            bool stopping = false;
+
+            static std::string due_key(const expiry_entry_t & entry);
+            void run();
+    };
+}
+
+#endif
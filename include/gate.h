@@ -0,0 +1,74 @@
+#ifndef _GATE_H
+#define _GATE_H
+
+#include <opencv2/opencv.hpp>
+#include "loguru.hpp"
+#include "common.h"
+
+
+namespace GLCC {
+    // Cheap frame differencing on a downscaled grayscale copy, run before dect().
+    // The reference frame only moves on the frames that pass, so slow motion still adds up.
+    class MotionGate {
+        public:
+            MotionGate(const bool enable=false,
+                       const int scale_width=160,
+                       const int pixel_thre=25,
+                       const float motion_thre=0.002,
+                       const int refresh_interval=50);
+            explicit MotionGate(const Json::Value & config);
+
+            // returns true if the frame has to be inferred
+            bool check(const cv::Mat & frame);
+
+            bool is_enable() const { return enable; }
+
+        private:
+            bool enable;
+            int scale_width;
+            int pixel_thre;
+            float motion_thre;
+            int refresh_interval;
+            int num_frames_from_refresh=0;
+            cv::Mat small;
+            cv::Mat gray;
+            cv::Mat reference;
+            cv::Mat diff;
+    };
+
+    // Runs the detector every detect_interval frames, the tracker predicts the frames between.
+    // The interval is doubled while the smoothed end-to-end latency is over the budget and
+    // stepped back by one once it falls under 80% of the budget, adjusting at most once per
+    // adjust_period frames. A budget of 0 detects every frame.
+    class DetectIntervalGate {
+        public:
+            DetectIntervalGate(const long latency_budget_millisecond=0,
+                               const int max_detect_interval=1,
+                               const int adjust_period=25);
+            explicit DetectIntervalGate(const Json::Value & extra_config);
+
+            // called by the infer stage, returns true if the frame has to be detected
+            bool check();
+            // called by the push stage with the latency from capture to push of a frame
+            void update(const long latency_microsecond);
+            // called by the infer stage, the floor the scheduler puts on the interval of the room
+            void set_min_detect_interval(const int interval) { min_detect_interval = std::max(interval, 1); }
+
+            int get_detect_interval() const { return detect_interval; }
+            long get_latency_microsecond() const { return (long)latency_ema; }
+
+        private:
+            const long latency_budget_microsecond;
+            const int max_detect_interval;
+            const int adjust_period;
+            std::atomic_int detect_interval{1};
+            // infer stage only
+            int num_frames_from_dect=0;
+            int min_detect_interval=1;
+            // push stage only
+            double latency_ema=0;
+            int num_frames_from_adjust=0;
+    };
+}
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef _INFERENCE_H
+#define _INFERENCE_H
+
+#include <deque>
+#include <future>
+#include <thread>
+#include <condition_variable>
+#include <opencv2/opencv.hpp>
+#include "loguru.hpp"
+#include "detector.h"
+#include "common.h"
+#include "BYTETracker.h"
+
+
+namespace GLCC {
+
+    typedef struct inference_request {
+        const cv::Mat * img;
+        std::vector<Object> * objects;
+        float score_thre;
+        std::chrono::steady_clock::time_point submit_time;
+        std::promise<int> result;
+    } inference_request_t;
+
+    // One mmdeploy handle shared by all the rooms running the same model on the same device.
+    // Rooms submit frames to the queue, the worker applies them in batches of up to
+    // max_batch_size, waiting at most max_wait_microsecond after the first frame arrives.
+    class InferenceEngine {
+        public:
+            InferenceEngine(const InferenceEngine &) = delete;
+            const InferenceEngine& operator=(const InferenceEngine &) = delete;
+
+            InferenceEngine(const std::string & model_path,
+                            const std::string & device_name,
+                            const int device_id,
+                            const int max_batch_size,
+                            const long max_wait_microsecond);
+            ~InferenceEngine();
+
+            int state = 0;
+            // blocks until the batch containing img is applied
+            int infer(const cv::Mat & img, std::vector<Object> & objects, float score_thre);
+            // runs num_runs inferences on a blank width x height frame so the backend allocates and
+            // tunes before the first room, the cost is measured from the last run only
+            int warm_up(const int width, const int height, const int num_runs);
+
+            uint64_t get_num_batches() const { return num_batches; }
+            uint64_t get_num_images() const { return num_images; }
+            // smoothed apply time per image of the batches, 0 until the first batch
+            long get_cost_microsecond() const { return cost_microsecond; }
+
+        private:
+            mm_handle_t handle = nullptr;
+            const int max_batch_size;
+            const long max_wait_microsecond;
+            std::mutex lock;
+            std::condition_variable cond;
+            std::deque<inference_request_t *> requests;
+            bool stopping = false;
+            std::thread worker;
+            std::atomic<uint64_t> num_batches{0};
+            std::atomic<uint64_t> num_images{0};
+            std::atomic_long cost_microsecond{0};
+
+            void run();
+            void apply(std::vector<inference_request_t *> & batch);
+    };
+
+    class InferenceService {
+        public:
+            InferenceService(const InferenceService &) = delete;
+            InferenceService(const InferenceService &&) = delete;
+            const InferenceService& operator=(const InferenceService &) = delete;
+            const InferenceService& operator=(const InferenceService &&) = delete;
+
+            static InferenceService & Instance() {
+                static InferenceService instance;
+                return instance;
+            }
+
+            // returns the engine of (model_path, device_name, device_id), creating it if none is loaded
+            std::shared_ptr<InferenceEngine> acquire(const std::string & model_path,
+                                                     const std::string & device_name,
+                                                     const int device_id);
+            // creates the engine at startup, warms it up and keeps it loaded until release,
+            // so the rooms acquiring it later skip the model loading
+            int preload(const std::string & model_path,
+                        const std::string & device_name,
+                        const int device_id,
+                        const int warmup_width,
+                        const int warmup_height,
+                        const int num_warmups);
+            // drops the preloaded engines, the rooms still running keep theirs
+            void release();
+            // the highest per image cost of the live engines, 0 if none is measured yet
+            long get_cost_microsecond();
+
+        private:
+            InferenceService() {}
+            ~InferenceService() {}
+
+            std::mutex lock;
+            std::unordered_map<std::string, std::weak_ptr<InferenceEngine>> engines;
+            // the models being loaded, out of the lock, by the first room asking for them
+            std::unordered_map<std::string, std::shared_future<std::shared_ptr<InferenceEngine>>> loadings;
+            std::unordered_map<std::string, std::shared_ptr<InferenceEngine>> preloaded;
+
+            static std::string engine_key(const std::string & model_path,
+                                          const std::string & device_name,
+                                          const int device_id);
+    };
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef _LATTICE_H
+#define _LATTICE_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <opencv2/opencv.hpp>
+#include "loguru.hpp"
+
+
+namespace GLCC {
+    typedef std::unordered_map<std::string, std::vector<cv::Point>> contour_list_t;
+
+    // an immutable set of contours, replaced as a whole on every edit
+    typedef struct contour_snapshot {
+        long version=0;
+        contour_list_t contour_list;
+    } contour_snapshot_t;
+
+    typedef struct lattice_zone {
+        std::string name;
+        std::vector<std::vector<cv::Point>> contours; // the contour, in the form fillPoly / polylines take
+        cv::Rect rect; // bounding rect clipped to the frame
+        cv::Mat mask; // contour rasterized inside rect
+        cv::Mat blend; // scratch of the rect size
+    } lattice_zone_t;
+
+    // Dwell state of the zones, indexed by the zone ids of LatticeCache
+    typedef struct zone_state {
+        std::vector<uint8_t> is_in_contour;
+        std::vector<uint8_t> is_into_timing;
+        std::vector<uint8_t> is_out_timing;
+        std::vector<std::chrono::system_clock::time_point> into_contour_time_point;
+        std::vector<std::chrono::system_clock::time_point> out_contour_time_point;
+        int num_in_contour=0;
+
+        // carry the state of the zones kept by a rebuild over to their new ids
+        void remap(const std::vector<int> & previous_ids);
+    } zone_state_t;
+
+    // Contours rasterized once each time contour_list or the frame size changes,
+    // so that the per-frame overlay only touches the pixels inside the bounding rects.
+    class LatticeCache {
+        public:
+            bool is_stale(const long version, const cv::Size & frame_size) const;
+            void build(const contour_list_t & contour_list, const cv::Size & frame_size, const long version);
+
+            // frame = (1 - alpha) * frame + alpha * color inside the contour
+            void fill(cv::Mat & frame, const int zone_id, const cv::Scalar & color, const double alpha);
+            void outline(cv::Mat & frame, const int zone_id, const cv::Scalar & color, const int thickness) const;
+
+            // mark the zones holding at least one of the centers, read back by is_occupied
+            void locate(const std::vector<cv::Point> & centers);
+            bool is_occupied(const int zone_id) const {
+                return (occupied[zone_id >> 6] >> (zone_id & 63)) & 1;
+            }
+
+            // returns -1 if there is no such zone
+            int find(const std::string & name) const;
+            int size() const { return zones.size(); }
+            // id of each zone in the previous build, -1 for the new ones
+            const std::vector<int> & get_previous_ids() const { return previous_ids; }
+            const lattice_zone_t & get_zone(const int zone_id) const { return zones[zone_id]; }
+
+        private:
+            long version = -1;
+            cv::Size frame_size;
+            std::vector<lattice_zone_t> zones;
+            std::unordered_map<std::string, int> zone_ids;
+            std::vector<int> previous_ids;
+
+            // Zone index: the frame is cut into cells of cell_size pixels, every cell keeps one bit per zone
+            // in inside_bits if the cell lies in the zone and in boundary_bits if an edge of the zone
+            // crosses it (within one pixel). Only the boundary zones are tested exactly.
+            static const int cell_size = 16;
+            int grid_cols = 0;
+            int grid_rows = 0;
+            int num_words = 0;
+            std::vector<uint64_t> inside_bits;
+            std::vector<uint64_t> boundary_bits;
+            std::vector<uint64_t> occupied;
+
+            void build_index();
+            bool contains(const int zone_id, const cv::Point & center) const;
+    };
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef _LIFECYCLE_H
+#define _LIFECYCLE_H
+
+#include <condition_variable>
+#include "loguru.hpp"
+#include "common.h"
+
+
+namespace GLCC {
+    enum LifecycleState {LIFECYCLE_STARTING=0, LIFECYCLE_RUNNING=1, LIFECYCLE_DRAINING=2, LIFECYCLE_STOPPED=3};
+
+    // Starting -> Running -> Draining -> Stopped, a detector cancelled before it runs goes from
+    // Starting to Draining. cancel is the token of the runner: it polls is_cancelled once per
+    // frame or sleeps in wait_cancel, which cancel wakes. finish is called once the runner has
+    // released everything of the room and wakes the callers blocked in join.
+    class Lifecycle {
+        public:
+            Lifecycle(const Lifecycle &) = delete;
+            const Lifecycle& operator=(const Lifecycle &) = delete;
+            Lifecycle() {}
+
+            int get_state() const noexcept { return state.load(std::memory_order_acquire); }
+            bool is_cancelled() const noexcept { return get_state() >= LIFECYCLE_DRAINING; }
+
+            // Starting -> Running, returns false if it was cancelled first
+            bool start();
+            // Starting or Running -> Draining, returns false if it was already draining or stopped
+            bool cancel();
+            // -> Stopped
+            void finish();
+            // returns true as soon as it is cancelled, false after timeout_millisecond
+            bool wait_cancel(const long timeout_millisecond);
+            // returns false if it is not stopped after timeout_millisecond
+            bool join(const long timeout_millisecond);
+
+        private:
+            std::mutex lock;
+            std::condition_variable cond;
+            std::atomic_int state{LIFECYCLE_STARTING};
+
+            bool transit(const int from, const int to);
+    };
+}
+
+#endif
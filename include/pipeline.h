@@ -0,0 +1,336 @@
+#ifndef _PIPELINE_H
+#define _PIPELINE_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include "loguru.hpp"
+
+
+namespace GLCC {
+    enum DropMode {BLOCK_DROP=0, NEWEST_DROP=1, OLDEST_DROP=2};
+    enum StageState {STAGE_STOP=-1, STAGE_PASS=0, STAGE_SKIP=1};
+
+    int parse_drop_mode(const std::string & mode, const int default_mode=BLOCK_DROP) noexcept;
+
+    inline void backoff_wait(int & spins) {
+        if (spins < 64) {
+            spins++;
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+
+    // Bounded lock-free ring of pointers. One thread pushes, the others pop.
+    // Pop claims the head with CAS, so the producer can also evict the oldest item.
+    template <class Item_t>
+    class RingBuffer {
+        public:
+            RingBuffer(const RingBuffer &) = delete;
+            const RingBuffer& operator=(const RingBuffer &) = delete;
+
+            explicit RingBuffer(const size_t capacity): capacity(capacity > 0 ? capacity : 1), slots(this->capacity) {
+                for (auto & slot : slots) {
+                    slot.store(nullptr, std::memory_order_relaxed);
+                }
+            }
+
+            bool try_push(Item_t * item) {
+                size_t t = tail.load(std::memory_order_relaxed);
+                size_t h = head.load(std::memory_order_acquire);
+                if (t - h >= capacity) {
+                    return false;
+                }
+                slots[t % capacity].store(item, std::memory_order_release);
+                tail.store(t + 1, std::memory_order_release);
+                return true;
+            }
+
+            Item_t * try_pop() {
+                size_t h = head.load(std::memory_order_acquire);
+                for (;;) {
+                    size_t t = tail.load(std::memory_order_acquire);
+                    if (h == t) {
+                        return nullptr;
+                    }
+                    Item_t * item = slots[h % capacity].load(std::memory_order_acquire);
+                    if (head.compare_exchange_weak(h, h + 1,
+                            std::memory_order_acq_rel, std::memory_order_acquire)) {
+                        return item;
+                    }
+                }
+            }
+
+            bool empty() const {
+                return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+            }
+
+            size_t size() const {
+                return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+            }
+
+            size_t get_capacity() const {
+                return capacity;
+            }
+
+        private:
+            const size_t capacity;
+            std::vector<std::atomic<Item_t *>> slots;
+            std::atomic<size_t> head{0};
+            std::atomic<size_t> tail{0};
+    };
+
+    // Preallocated packets recycled through a free list, so the steady state of a pipeline
+    // does not allocate. Acquire and release may be called from any stage thread.
+    // num_allocations counts the allocations after the preallocation, including the ones
+    // reported by the stages through count_allocation (e.g. a frame buffer reallocated).
+    template <class Packet_t>
+    class FramePool {
+        public:
+            FramePool(const FramePool &) = delete;
+            const FramePool& operator=(const FramePool &) = delete;
+
+            FramePool(const size_t size, std::function<void(Packet_t *)> init_func = nullptr):
+                init_func(init_func) {
+                packets.reserve(size);
+                free_packets.reserve(size);
+                for (size_t i = 0; i < size; i++) {
+                    free_packets.emplace_back(create());
+                }
+            }
+
+            Packet_t * acquire() {
+                {
+                    std::lock_guard<std::mutex> lock_guard(lock);
+                    if (!free_packets.empty()) {
+                        Packet_t * packet = free_packets.back();
+                        free_packets.pop_back();
+                        return packet;
+                    }
+                }
+                count_allocation();
+                std::lock_guard<std::mutex> lock_guard(lock);
+                return create();
+            }
+
+            void release(Packet_t * packet) {
+                std::lock_guard<std::mutex> lock_guard(lock);
+                free_packets.emplace_back(packet);
+            }
+
+            void count_allocation() {
+                num_allocations.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            uint64_t get_num_allocations() const {
+                return num_allocations.load(std::memory_order_relaxed);
+            }
+
+            size_t get_size() {
+                std::lock_guard<std::mutex> lock_guard(lock);
+                return packets.size();
+            }
+
+        private:
+            std::function<void(Packet_t *)> init_func;
+            std::mutex lock;
+            // owns every packet, the ones in flight included
+            std::vector<std::unique_ptr<Packet_t>> packets;
+            std::vector<Packet_t *> free_packets;
+            std::atomic<uint64_t> num_allocations{0};
+
+            Packet_t * create() {
+                packets.emplace_back(new Packet_t);
+                Packet_t * packet = packets.back().get();
+                if (init_func != nullptr) {
+                    init_func(packet);
+                }
+                return packet;
+            }
+    };
+
+    // Runs every stage on its own thread, stage i feeds stage i + 1 through a RingBuffer.
+    // The first stage is the source: it fills the packets from acquire_func and stops the
+    // pipeline gracefully with STAGE_STOP, the others abort the pipeline with STAGE_STOP.
+    template <class Packet_t>
+    class FramePipeline {
+        public:
+            typedef std::function<int(Packet_t *)> stage_func_t;
+
+            FramePipeline(const FramePipeline &) = delete;
+            const FramePipeline& operator=(const FramePipeline &) = delete;
+
+            FramePipeline(std::function<Packet_t * ()> acquire_func,
+                          std::function<void(Packet_t *)> release_func):
+                acquire_func(acquire_func), release_func(release_func) {}
+
+            ~FramePipeline() {
+                stop();
+                for (auto & queue : queues) {
+                    drain(*queue);
+                }
+            }
+
+            void add_stage(const std::string & name, stage_func_t func,
+                           const size_t queue_size=2, const int drop_mode=BLOCK_DROP) {
+                std::unique_ptr<stage_t> stage(new stage_t);
+                stage->name = name;
+                stage->func = func;
+                stage->drop_mode = drop_mode;
+                stages.emplace_back(std::move(stage));
+                queues.emplace_back(new RingBuffer<Packet_t>(queue_size));
+            }
+
+            int run() {
+                if (stages.size() == 0) {
+                    return -1;
+                }
+                aborted = false;
+                std::vector<std::thread> workers;
+                for (size_t i = 1; i < stages.size(); i++) {
+                    workers.emplace_back(&FramePipeline::run_stage, this, i);
+                }
+                run_source();
+                for (auto & worker : workers) {
+                    worker.join();
+                }
+                for (auto & queue : queues) {
+                    drain(*queue);
+                }
+                return aborted ? -1 : 0;
+            }
+
+            void stop() {
+                aborted = true;
+            }
+
+            const std::string & get_stage_name(const size_t index) const {
+                return stages[index]->name;
+            }
+
+            size_t get_num_stages() const {
+                return stages.size();
+            }
+
+            uint64_t get_num_processed(const size_t index) const {
+                return stages[index]->num_processed.load(std::memory_order_relaxed);
+            }
+
+            uint64_t get_num_dropped(const size_t index) const {
+                return stages[index]->num_dropped.load(std::memory_order_relaxed);
+            }
+
+        private:
+            typedef struct stage {
+                std::string name;
+                stage_func_t func;
+                int drop_mode;
+                std::atomic_bool finished{false};
+                std::atomic<uint64_t> num_processed{0};
+                std::atomic<uint64_t> num_dropped{0};
+            } stage_t;
+
+            std::function<Packet_t * ()> acquire_func;
+            std::function<void(Packet_t *)> release_func;
+            std::vector<std::unique_ptr<stage_t>> stages;
+            std::vector<std::unique_ptr<RingBuffer<Packet_t>>> queues;
+            std::atomic_bool aborted{false};
+
+            void drain(RingBuffer<Packet_t> & queue) {
+                Packet_t * packet;
+                while ((packet = queue.try_pop()) != nullptr) {
+                    release_func(packet);
+                }
+            }
+
+            // the last stage has nowhere to push, the packet is released there
+            void forward(const size_t index, Packet_t * packet) {
+                stage_t & stage = *stages[index];
+                stage.num_processed.fetch_add(1, std::memory_order_relaxed);
+                if (index + 1 == stages.size()) {
+                    release_func(packet);
+                    return;
+                }
+                RingBuffer<Packet_t> & queue = *queues[index];
+                int spins = 0;
+                while (!queue.try_push(packet)) {
+                    if (aborted) {
+                        release_func(packet);
+                        return;
+                    }
+                    if (stage.drop_mode == NEWEST_DROP) {
+                        stage.num_dropped.fetch_add(1, std::memory_order_relaxed);
+                        release_func(packet);
+                        return;
+                    } else if (stage.drop_mode == OLDEST_DROP) {
+                        Packet_t * oldest = queue.try_pop();
+                        if (oldest != nullptr) {
+                            stage.num_dropped.fetch_add(1, std::memory_order_relaxed);
+                            release_func(oldest);
+                        }
+                    } else {
+                        backoff_wait(spins);
+                    }
+                }
+            }
+
+            void run_source() {
+                stage_t & stage = *stages[0];
+                while (!aborted) {
+                    Packet_t * packet = acquire_func();
+                    if (packet == nullptr) {
+                        LOG_F(ERROR, "[Pipeline][%s] Acquire packet fail!", stage.name.c_str());
+                        aborted = true;
+                        break;
+                    }
+                    int ret = stage.func(packet);
+                    if (ret == STAGE_PASS) {
+                        forward(0, packet);
+                    } else {
+                        release_func(packet);
+                        if (ret == STAGE_STOP) {
+                            break;
+                        }
+                    }
+                }
+                stage.finished.store(true, std::memory_order_release);
+            }
+
+            void run_stage(const size_t index) {
+                stage_t & stage = *stages[index];
+                stage_t & upstream = *stages[index - 1];
+                RingBuffer<Packet_t> & queue = *queues[index - 1];
+                int spins = 0;
+                while (!aborted) {
+                    Packet_t * packet = queue.try_pop();
+                    if (packet == nullptr) {
+                        if (upstream.finished.load(std::memory_order_acquire) && queue.empty()) {
+                            break;
+                        }
+                        backoff_wait(spins);
+                        continue;
+                    }
+                    spins = 0;
+                    int ret = stage.func(packet);
+                    if (ret == STAGE_PASS) {
+                        forward(index, packet);
+                    } else {
+                        release_func(packet);
+                        if (ret == STAGE_STOP) {
+                            LOG_F(WARNING, "[Pipeline][%s] Stage stop the pipeline!", stage.name.c_str());
+                            aborted = true;
+                        }
+                    }
+                }
+                stage.finished.store(true, std::memory_order_release);
+            }
+    };
+}
+
+#endif
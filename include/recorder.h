@@ -0,0 +1,95 @@
+#ifndef _RECORDER_H
+#define _RECORDER_H
+
+#include <deque>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <functional>
+#include <condition_variable>
+#include <opencv2/opencv.hpp>
+#include "loguru.hpp"
+#include "common.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+
+namespace GLCC {
+    enum ClipItemType {CLIP_PACKET=0, CLIP_START=1, CLIP_STOP=2, CLIP_COVER=3};
+
+    typedef struct clip_item {
+        int type=CLIP_PACKET;
+        AVPacket * packet=nullptr;
+        std::string path;
+        cv::Mat cover;
+    } clip_item_t;
+
+    // Records the clips of a room on its own thread from the packets of the StreamEncoder,
+    // so that the detector threads only queue references. The last pre_event_second seconds
+    // of packets (from a keyframe on) are kept in a ring, a clip starts with them as lead-in.
+    class ClipRecorder {
+        public:
+            ClipRecorder(const ClipRecorder &) = delete;
+            const ClipRecorder& operator=(const ClipRecorder &) = delete;
+
+            ClipRecorder(const int pre_event_second=3, const size_t queue_size=256);
+            ~ClipRecorder();
+
+            // codecpar and time_base of the packets to be pushed, on the recorder thread open_func
+            // is called with the path of each clip once its file is open, and close_func with the
+            // path and the cover frame of each finished clip
+            int open(const AVCodecParameters * codecpar,
+                     const AVRational time_base,
+                     std::function<void(const std::string &)> open_func = nullptr,
+                     std::function<void(const std::string &, const cv::Mat &)> close_func = nullptr);
+            void close();
+
+            // called by the encoder, the packet is referenced, not copied
+            void push(const AVPacket * packet);
+            void start(const std::string & path);
+            void stop();
+            // the frame to make the cover of the current clip from, owned by the recorder
+            void set_cover(cv::Mat && cover);
+
+            uint64_t get_num_dropped() const { return num_dropped; }
+
+        private:
+            const int pre_event_second;
+            const size_t queue_size;
+            std::function<void(const std::string &)> open_func;
+            std::function<void(const std::string &, const cv::Mat &)> close_func;
+
+            std::mutex lock;
+            std::condition_variable cond;
+            std::deque<clip_item_t> queue;
+            bool stopping=false;
+            bool wait_keyframe=false;
+            std::thread worker;
+            std::atomic<uint64_t> num_dropped{0};
+
+            // recorder thread only
+            AVCodecParameters * codecpar=nullptr;
+            AVRational time_base{1, 25};
+            std::deque<AVPacket *> ring;
+            AVFormatContext * clip_context=nullptr;
+            AVStream * clip_stream=nullptr;
+            AVPacket * clip_packet=nullptr;
+            int64_t clip_start_pts=0;
+            std::string clip_path;
+            cv::Mat clip_cover;
+
+            void run();
+            void enqueue(clip_item_t && item);
+            void put_ring(AVPacket * packet);
+            int open_clip(const std::string & path);
+            int write_clip(const AVPacket * packet);
+            void close_clip();
+    };
+}
+
+#endif
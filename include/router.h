@@ -0,0 +1,37 @@
+#ifndef _ROUTER_H
+#define _ROUTER_H
+
+#include <workflow/WFTaskFactory.h>
+#include "common.h"
+
+
+namespace GLCC {
+    typedef std::function<void(WFHttpTask *, void *)> route_func_t;
+
+    // Routes are registered once at startup. Exact routes are looked up by method and path
+    // (query string stripped) in a hash map, so dispatch costs one hash of the path;
+    // prefix routes are only tried when no exact route matches, the longest prefix wins.
+    class Router {
+        public:
+            int add(const std::string & method, const std::string & path, route_func_t func);
+            int add_prefix(const std::string & method, const std::string & prefix, route_func_t func);
+
+            // returns nullptr if no route matches
+            const route_func_t * find(const std::string & method, const std::string & uri) const;
+            // returns false if no route matches
+            bool dispatch(WFHttpTask * task, void * context) const;
+
+        private:
+            typedef struct prefix_route {
+                std::string prefix;
+                route_func_t func;
+            } prefix_route_t;
+
+            // method -> path -> func
+            std::unordered_map<std::string, std::unordered_map<std::string, route_func_t>> routes;
+            // method -> prefix routes, longest first
+            std::unordered_map<std::string, std::vector<prefix_route_t>> prefix_routes;
+    };
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef _ROW_MAPPER_H
+#define _ROW_MAPPER_H
+
+#include <workflow/WFTaskFactory.h>
+#include <workflow/MySQLResult.h>
+#include "common.h"
+
+
+namespace GLCC {
+    // decode a text protocol cell without copying it out of the response,
+    // returns -1 and leaves value untouched if the cell is NULL or can't be parsed
+    int decode_cell(const protocol::MySQLCell & cell, std::string & value) noexcept;
+    int decode_cell(const protocol::MySQLCell & cell, int & value) noexcept;
+    int decode_cell(const protocol::MySQLCell & cell, long long & value) noexcept;
+    int decode_cell(const protocol::MySQLCell & cell, double & value) noexcept;
+
+    // the dumps format every cell, only call them when is_mysql_dump() holds
+    inline bool is_mysql_dump() noexcept { return loguru::current_verbosity_cutoff() >= 1; }
+    void dump_mysql_fields(const protocol::MySQLResultCursor & cursor);
+    void dump_mysql_row(const protocol::MySQLField * const * fields, const std::vector<protocol::MySQLCell> & row);
+    void dump_mysql_status(const protocol::MySQLResponse * resp);
+
+    // Maps the rows of a result set into Row_t. Columns are bound to members by name once,
+    // the names are resolved to indexes once per result set and the cells are decoded in place.
+    template<typename Row_t>
+    class RowMapper {
+        public:
+            template<typename Value_t>
+            RowMapper & bind(const std::string & column, Value_t Row_t::* member) {
+                bindings.push_back(binding_t{column, [member](const protocol::MySQLCell & cell, Row_t & row) {
+                    return decode_cell(cell, row.*member);
+                }});
+                return *this;
+            }
+
+            // appends the rows of the current result set of cursor,
+            // returns -1 if a bound column is missing from the result set
+            int map(protocol::MySQLResultCursor & cursor, std::vector<Row_t> & rows) const {
+                if (cursor.get_cursor_status() != MYSQL_STATUS_GET_RESULT) {
+                    return 0;
+                }
+                const bool is_dump = is_mysql_dump();
+                if (is_dump) {
+                    dump_mysql_fields(cursor);
+                }
+                const protocol::MySQLField * const * fields = cursor.fetch_fields();
+                const int num_fields = cursor.get_field_count();
+                std::vector<int> indexes(bindings.size(), -1);
+                for (size_t i = 0; i < bindings.size(); i++) {
+                    for (int j = 0; j < num_fields; j++) {
+                        if (fields[j]->get_name() == bindings[i].column) {
+                            indexes[i] = j;
+                            break;
+                        }
+                    }
+                    if (indexes[i] == -1) {
+                        LOG_F(ERROR, "[RowMapper] Find column %s fail!", bindings[i].column.c_str());
+                        return -1;
+                    }
+                }
+                rows.reserve(rows.size() + cursor.get_rows_count());
+                std::vector<protocol::MySQLCell> cells;
+                while (cursor.fetch_row(cells)) {
+                    if (is_dump) {
+                        dump_mysql_row(fields, cells);
+                    }
+                    Row_t row;
+                    for (size_t i = 0; i < bindings.size(); i++) {
+                        bindings[i].decode(cells[indexes[i]], row);
+                    }
+                    rows.emplace_back(std::move(row));
+                }
+                return 0;
+            }
+
+        private:
+            typedef struct binding {
+                std::string column;
+                std::function<int(const protocol::MySQLCell &, Row_t &)> decode;
+            } binding_t;
+
+            std::vector<binding_t> bindings;
+    };
+
+    // maps the first result set of the task that holds rows, returns WFT_STATE_TASK_ERROR on an error packet or a missing column
+    template<typename Row_t>
+    int map_mysql_response(WFMySQLTask * task, const RowMapper<Row_t> & mapper, std::vector<Row_t> & rows) {
+        protocol::MySQLResponse * resp = task->get_resp();
+        if (is_mysql_dump()) {
+            dump_mysql_status(resp);
+        }
+        if (resp->get_packet_type() == MYSQL_PACKET_ERROR) {
+            return WFT_STATE_TASK_ERROR;
+        }
+        protocol::MySQLResultCursor cursor(resp);
+        // the statements of a multi-statement query before the select answer with ok packets
+        while (cursor.get_cursor_status() == MYSQL_STATUS_OK && cursor.next_result_set()) {}
+        return mapper.map(cursor, rows) == 0 ? WFT_STATE_SUCCESS : WFT_STATE_TASK_ERROR;
+    }
+}
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef _SCHEDULER_H
+#define _SCHEDULER_H
+
+#include <deque>
+#include <thread>
+#include <workflow/WFTaskFactory.h>
+#include "loguru.hpp"
+#include "common.h"
+
+
+namespace GLCC {
+    enum RoomAdmission {ROOM_REJECTED=-1, ROOM_ADMITTED=0, ROOM_QUEUED=1};
+
+    // the share of the node a room runs with, assigned_fps is read by its infer stage every frame
+    typedef struct room_quota {
+        uint64_t id = 0;
+        std::string room_name;
+        int priority = 0;
+        int target_fps = 0; // 0 follows the stream
+        std::atomic_int stream_fps{0}; // set by the runner once the stream is open
+        std::atomic_int assigned_fps{0};
+        int state = ROOM_QUEUED;
+        bool is_cancelled = false; // stopping, a new request for the room is admitted again
+        std::function<int(std::shared_ptr<room_quota>)> start_func; // kept while queued
+    } room_quota_t;
+
+    // returns -1 if the room couldn't start, the scheduler takes it out again
+    typedef std::function<int(std::shared_ptr<room_quota_t>)> room_start_t;
+
+    // Admits the rooms against the capacity of the node: the inferences per second of all the rooms
+    // within max_utilization of what the engines can apply at their measured cost per image, and at
+    // most one room per executor worker. rooms_per_core, if set, only caps the rooms further, the
+    // measured cost is what bounds them. Each admitted room is given at least min_fps
+    // inferences per second, the rest of the capacity goes to the rooms by priority up to their
+    // target_fps, so the low priority rooms are degraded first. A room that doesn't fit waits in
+    // a queue of queue_size, ordered by priority, until a room leaves, or is rejected. A room
+    // without target_fps wants the fps of its stream, it isn't throttled while the capacity lasts.
+    class RoomScheduler {
+        public:
+            RoomScheduler(const RoomScheduler &) = delete;
+            RoomScheduler(const RoomScheduler &&) = delete;
+            const RoomScheduler& operator=(const RoomScheduler &) = delete;
+            const RoomScheduler& operator=(const RoomScheduler &&) = delete;
+
+            static RoomScheduler & Instance() {
+                static RoomScheduler instance;
+                return instance;
+            }
+
+            int init(const double rooms_per_core, const double max_utilization, const long default_cost_microsecond,
+                     const int min_fps, const size_t queue_size, const long rebalance_second);
+            void release();
+
+            // start_func is called with the quota of the room once it is admitted, at once or when
+            // it leaves the queue, and leave has to be called with that quota once the room stops.
+            // A room whose start_func fails at once is rejected. A room already queued or running
+            // isn't admitted twice, its state is returned.
+            int admit(const std::string & room_name, const int priority, const int target_fps, room_start_t start_func);
+            void leave(const std::shared_ptr<room_quota_t> & quota);
+            // drops the queued entry of the room and lets a new request for a running one in again
+            void cancel(const std::string & room_name);
+
+            Json::Value get_state();
+
+        private:
+            RoomScheduler() {}
+            ~RoomScheduler() {}
+
+            std::mutex lock;
+            double rooms_per_core = 0; // no cap
+            double max_utilization = 0.8;
+            long default_cost_microsecond = 20000;
+            int min_fps = 1;
+            size_t queue_size = 16;
+            long rebalance_second = 5;
+            bool stopping = false;
+            uint64_t next_id = 1;
+            uint64_t num_rejected = 0;
+            std::vector<std::shared_ptr<room_quota_t>> rooms;
+            std::deque<std::shared_ptr<room_quota_t>> queue;
+            // refreshed by rebalance
+            long cost_microsecond = 0;
+            int max_rooms = 1;
+            int capacity_fps = 0;
+
+            // the stream fps isn't known before the room runs, it wants what is left until then
+            int get_target_fps(const room_quota_t & quota) const {
+                return quota.target_fps > 0 ? quota.target_fps : (quota.stream_fps > 0 ? (int)quota.stream_fps : capacity_fps);
+            }
+            int get_min_fps(const room_quota_t & quota) const { return std::min(min_fps, get_target_fps(quota)); }
+            bool fits(const room_quota_t & quota) const;
+            // reads the measured cost and the workers again, lock is held
+            void refresh_capacity();
+            // refreshes the capacity, assigns the fps and takes the queued rooms that fit, lock is held
+            void rebalance(std::vector<std::shared_ptr<room_quota_t>> & started);
+            // returns -1 if the start of admitted failed
+            int start(std::vector<std::shared_ptr<room_quota_t>> && started,
+                      const std::shared_ptr<room_quota_t> & admitted=nullptr);
+            void schedule_rebalance();
+    };
+}
+
+#endif
@@ -3,6 +3,15 @@
 
 #include "common.h"
 #include "dealtor.h"
+#include "transfer.h"
+#include "router.h"
+#include "session.h"
+#include "row_mapper.h"
+#include "statement.h"
+#include "write_behind.h"
+#include "expiry.h"
+#include "executor.h"
+#include "scheduler.h"
 #include <workflow/WFFacilities.h>
 #include <workflow/WFHttpServer.h>
 #include <workflow/WFAlgoTaskFactory.h>
@@ -12,6 +21,43 @@
 #include <workflow/Workflow.h>
 
 namespace GLCC {
+    // rows of the queries the server reads back, filled by RowMapper
+    typedef struct user_row {
+        std::string username;
+        std::string password;
+    } user_row_t;
+
+    typedef struct video_row {
+        std::string video_name;
+        std::string video_url;
+    } video_row_t;
+
+    typedef struct contour_row {
+        std::string video_name;
+        std::string contour_name;
+        std::string contour_path;
+    } contour_row_t;
+
+    typedef struct file_row {
+        std::string video_name;
+        std::string file_path;
+        std::string start_time;
+        std::string end_time;
+    } file_row_t;
+
+    typedef struct room_row {
+        std::string room_name;
+    } room_row_t;
+
+    // end_second is UNIX_TIMESTAMP(end_time)
+    typedef struct expiry_row {
+        std::string user_name;
+        std::string video_name;
+        std::string file_path;
+        std::string room_name;
+        long long end_second = 0;
+    } expiry_row_t;
+
     class GLCCServer
     {
         public:
@@ -22,18 +68,14 @@ namespace GLCC {
             static WFFacilities::WaitGroup server_wait_group;
             static WFFacilities::WaitGroup mysql_wait_group;
             static void sig_handler(int signo);
-            static bool parse_request(WFHttpTask * task, 
-                                        std::string method, 
-                                        std::string rex);
             static void get_connection_infos(WFHttpTask * task, std::iostream & context);
             static void get_connection_infos(WFHttpTask * task, Json::Value & context);
             static void get_server_infos(WFHttpServer * server, std::iostream & context);
             static void get_server_infos(WFHttpServer * server, Json::Value & context);
-            static int parse_mysql_response(WFMySQLTask * task, std::unordered_map<std::string, std::vector<protocol::MySQLCell>> & results);
             static int parse_mysql_response(WFMySQLTask * task);
 
             static void run_detector(const std::string & room_name, std::shared_ptr<glcc_server_context_t> context);
-            static Detector * register_detector(const std::string & room_name, std::shared_ptr<glcc_server_context_t> context, int mode=Create_Register);
+            static std::shared_ptr<Detector> register_detector(const std::string & room_name, std::shared_ptr<glcc_server_context_t> context, int mode=Create_Register);
             static int cancel_detector(const std::string & room_name, int mode=WAKE_CANCEL);
             static int parse_url(const std::string & url, std::unordered_map<std::string, std::string> & results_map);
             static int parse_url(const char * url, std::unordered_map<std::string, std::string> & results_map);
@@ -42,6 +84,11 @@ namespace GLCC {
         protected:
             glcc_server_context_t glcc_server_context;
             ssl_context_t glcc_server_ssl_context;
+            static Router main_router;
+            static Router login_router;
+
+            static void init_router();
+            static void init_statements();
 
             static void login_activity(WFHttpTask * task, void * context);
             // base
@@ -49,9 +96,11 @@ namespace GLCC {
             static void login_callback(WFHttpTask * task, void * context);
             static void user_register_callback(WFHttpTask * task, void * context);
             static void hello_world_callback(WFHttpTask * task);
+            static void scheduler_callback(WFHttpTask * task);
             // mysql
             static void create_db_callbck(WFMySQLTask * task, void * context);
             // detector
+            static void preload_models(const Json::Value & detector_init_context);
             static void dect_video_callback(WFHttpTask * task, void * context);
             static void dect_video_file_callback(WFHttpTask * task, void * context);
             static void kick_dect_video_file_callback(WFHttpTask * task, void * context);
@@ -59,12 +108,21 @@ namespace GLCC {
             static void video_put_lattice_callback(WFHttpTask * task, void * context);
             static void video_disput_lattice_callback(WFHttpTask * task, void * context);
             static void fetch_video_file_callback(WFHttpTask * task, void * context);
+            static void reply_video_files(SeriesWork * series, protocol::HttpResponse * resp, 
+                                          Json::Value && reply, std::vector<thumbnail_wait_t> && pending_covers);
+            static void wait_covers(SeriesWork * series, protocol::HttpResponse * resp,
+                                    std::shared_ptr<Json::Value> reply, std::shared_ptr<std::vector<thumbnail_wait_t>> pending_covers,
+                                    const std::chrono::steady_clock::time_point deadline);
             static void delete_video_file_callback(WFHttpTask * task, void * context);
             static void transmiss_video_file_callback(WFHttpTask * task, void * context);
-            static void register_map(const std::string & mode, const std::string & room_name, void * context);
-            // timer
-            static void detector_timer_callback(WFTimerTask * timer);
-            static void file_timer_callback(WFTimerTask * timer);
+            // is_created is set if this call created the detector of room_name
+            static std::shared_ptr<Detector> register_map(const std::string & mode, const std::string & room_name, 
+                                                          void * context, bool * is_created = nullptr);
+            // expiry
+            static void init_expiry();
+            static void load_expiries(long long from_second, long long to_second);
+            static void expire_files(std::vector<expiry_entry_t> && files);
+            static void expire_rooms(std::vector<expiry_entry_t> && rooms);
             // video
             static void register_video_callback(WFHttpTask * task, void * context);
             static void delete_video_callback(WFHttpTask * task, void * context);
@@ -0,0 +1,61 @@
+#ifndef _SESSION_H
+#define _SESSION_H
+
+#include <list>
+#include <errno.h>
+#include <sys/random.h>
+#include "common.h"
+
+
+namespace GLCC {
+    typedef struct session {
+        std::string token;
+        std::string user_name;
+        std::string user_password;
+        std::chrono::steady_clock::time_point expire_time;
+    } session_t;
+
+    // Tokens issued by /login, checked in memory by the /login/* calls instead of querying the User table.
+    // Sessions are spread over shards by token hash, each shard keeps its own lru list and evicts
+    // the least recently used session once it holds max_sessions / num_shards. The ttl slides on every check.
+    class SessionTable {
+        public:
+            SessionTable(const SessionTable &) = delete;
+            SessionTable(const SessionTable &&) = delete;
+            const SessionTable& operator=(const SessionTable &) = delete;
+            const SessionTable& operator=(const SessionTable &&) = delete;
+
+            static SessionTable & Instance() {
+                static SessionTable instance(constants::session_num_shards,
+                    constants::session_max_sessions, constants::session_ttl_second);
+                return instance;
+            }
+
+            // returns the new token, empty if no random bytes could be read
+            std::string create(const std::string & user_name, const std::string & user_password);
+            // returns -1 if the token is unknown, expired or issued to another user
+            int check(const std::string & token, const std::string & user_name, const std::string & user_password);
+            int erase(const std::string & token);
+            // drops every session of user_name, called when the user is deleted or its password changes
+            int invalidate_user(const std::string & user_name);
+
+        private:
+            typedef struct shard {
+                std::mutex lock;
+                std::list<session_t> lru; // most recently used first
+                std::unordered_map<std::string, std::list<session_t>::iterator> sessions;
+            } shard_t;
+
+            SessionTable(const int num_shards, const long max_sessions, const long ttl_second);
+            ~SessionTable() {}
+
+            const long max_shard_sessions;
+            const std::chrono::seconds ttl;
+            std::vector<std::unique_ptr<shard_t>> shards;
+
+            shard_t & get_shard(const std::string & token);
+            std::string make_token();
+    };
+}
+
+#endif
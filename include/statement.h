@@ -0,0 +1,75 @@
+#ifndef _STATEMENT_H
+#define _STATEMENT_H
+
+#include <workflow/WFTaskFactory.h>
+#include <workflow/MySQLResult.h>
+#include "common.h"
+
+
+namespace GLCC {
+    // a bound parameter, kept as the sql literal it is sent as
+    class SqlParam {
+        public:
+            SqlParam(const std::string & value);
+            SqlParam(const char * value);
+            SqlParam(const int value);
+            SqlParam(const long value);
+            SqlParam(const long long value);
+
+            const std::string & literal() const noexcept { return value_literal; }
+
+        private:
+            std::string value_literal;
+    };
+
+    typedef std::vector<SqlParam> sql_params_t;
+    typedef std::function<void (WFMySQLTask *)> mysql_callback_t;
+
+    // number of ? placeholders outside quoted strings
+    int count_placeholders(const std::string & sql) noexcept;
+    // "?,?,?" for an IN list of num_params values
+    std::string sql_placeholders(const size_t num_params);
+    // replaces the ? of sql with the literals of params in order, returns -1 if their counts differ
+    int bind_statement(const std::string & sql, const sql_params_t & params, std::string & query);
+
+    // Named statements with ? placeholders, registered once at startup and sent as text queries
+    // with the parameters bound in place as escaped literals. The server parses every call, the
+    // workflow client speaks only the text protocol.
+    class StatementCache {
+        public:
+            StatementCache(const StatementCache &) = delete;
+            StatementCache(const StatementCache &&) = delete;
+            const StatementCache& operator=(const StatementCache &) = delete;
+            const StatementCache& operator=(const StatementCache &&) = delete;
+
+            static StatementCache & Instance() {
+                static StatementCache instance;
+                return instance;
+            }
+
+            int init(const std::string & url);
+
+            // returns -1 if name is already registered
+            int add(const std::string & name, const std::string & sql);
+            // returns nullptr if name is unknown or params don't match its placeholders
+            WFMySQLTask * create_task(const std::string & name, const sql_params_t & params, mysql_callback_t callback);
+            // a statement built at the call, such as an IN list, sent as a text query
+            WFMySQLTask * create_query_task(const std::string & sql, const sql_params_t & params, mysql_callback_t callback);
+
+        private:
+            StatementCache() {}
+            ~StatementCache() {}
+
+            typedef struct statement {
+                std::string name;
+                std::string sql;
+                int num_params;
+            } statement_t;
+
+            std::mutex lock;
+            std::string url;
+            std::unordered_map<std::string, statement_t> statements;
+    };
+}
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef _THUMBNAIL_H
+#define _THUMBNAIL_H
+
+#include <deque>
+#include <future>
+#include <thread>
+#include <unordered_set>
+#include <condition_variable>
+#include <opencv2/opencv.hpp>
+#include "loguru.hpp"
+#include "common.h"
+
+
+namespace GLCC {
+    enum ThumbnailPolicy {PLACEHOLDER_POLICY=0, WAIT_POLICY=1};
+    enum ThumbnailState {THUMBNAIL_REJECT=-1, THUMBNAIL_READY=0, THUMBNAIL_PENDING=1, THUMBNAIL_RECORDING=2};
+
+    // a cover being generated, key and index locate its item in the reply
+    typedef struct thumbnail_wait {
+        std::string key;
+        int index;
+        std::shared_future<int> result;
+    } thumbnail_wait_t;
+
+    // <dirname>/<stem>.<cover_save_suffix> of the clip
+    int get_cover_path(const std::string & clip_path, std::string & cover_path) noexcept;
+    // encode the frame in process and write it to cover_path
+    int write_cover(const std::string & cover_path, const cv::Mat & frame) noexcept;
+
+    // Generates the missing covers of the clips on a bounded pool of workers, off the
+    // handler threads. Requests of a clip already queued share the same result.
+    class ThumbnailService {
+        public:
+            ThumbnailService(const ThumbnailService &) = delete;
+            ThumbnailService(const ThumbnailService &&) = delete;
+            const ThumbnailService& operator=(const ThumbnailService &) = delete;
+            const ThumbnailService& operator=(const ThumbnailService &&) = delete;
+
+            static ThumbnailService & Instance() {
+                static ThumbnailService instance;
+                return instance;
+            }
+
+            int init(const int num_workers, const size_t queue_size);
+            void release();
+
+            // THUMBNAIL_READY if the cover exists, THUMBNAIL_PENDING if it is being generated
+            // (result is set to its future), THUMBNAIL_RECORDING if the clip is still being
+            // written and gets its cover from the recorder, THUMBNAIL_REJECT if the queue is full
+            int request(const std::string & clip_path, std::shared_future<int> * result = nullptr);
+            // called by the recorders, an open clip has no index yet and can't be decoded
+            void set_recording(const std::string & clip_path, const bool is_recording);
+
+        private:
+            ThumbnailService() {}
+            ~ThumbnailService() { release(); }
+
+            typedef struct thumbnail_job {
+                std::string clip_path;
+                std::string cover_path;
+                std::promise<int> result;
+            } thumbnail_job_t;
+
+            std::mutex lock;
+            std::condition_variable cond;
+            std::deque<std::unique_ptr<thumbnail_job_t>> jobs;
+            std::unordered_map<std::string, std::shared_future<int>> in_flight;
+            std::unordered_set<std::string> recording;
+            std::vector<std::thread> workers;
+            size_t queue_size = 0;
+            bool stopping = false;
+
+            void run();
+            static int generate(const std::string & clip_path, const std::string & cover_path);
+    };
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef _TRANSFER_H
+#define _TRANSFER_H
+
+#include <time.h>
+#include <sys/stat.h>
+#include "common.h"
+
+
+namespace GLCC {
+    enum RangeState {RANGE_UNSATISFIABLE=-1, RANGE_NONE=0, RANGE_PARTIAL=1};
+
+    typedef struct transmiss_context {
+        int fd = -1;
+        std::vector<void *> chunks;
+        bool is_failed = false;
+    } transmiss_context_t;
+
+    // parse a single "bytes=start-end", "bytes=start-" or "bytes=-suffix" against size,
+    // [start, end] is inclusive, multiple ranges are served as the first one
+    int parse_range(const std::string & range, const size_t size, size_t & start, size_t & end) noexcept;
+    std::string get_content_type(const std::string & path) noexcept;
+    std::string make_etag(const struct stat & st) noexcept;
+    std::string make_http_date(const time_t time) noexcept;
+    // returns -1 if the date can't be parsed
+    time_t parse_http_date(const std::string & date) noexcept;
+
+    // Fixed-size buffers shared by all the downloads, a response takes all its chunks or none
+    // so the memory pinned by the transfers is bounded by num_chunks * chunk_size.
+    class ChunkPool {
+        public:
+            ChunkPool(const ChunkPool &) = delete;
+            ChunkPool(const ChunkPool &&) = delete;
+            const ChunkPool& operator=(const ChunkPool &) = delete;
+            const ChunkPool& operator=(const ChunkPool &&) = delete;
+
+            static ChunkPool & Instance() {
+                static ChunkPool instance(constants::transmiss_chunk_size, constants::transmiss_num_chunks);
+                return instance;
+            }
+
+            int acquire(const size_t num, std::vector<void *> & chunks);
+            void release(std::vector<void *> & chunks);
+            size_t get_chunk_size() const { return chunk_size; }
+
+        private:
+            ChunkPool(const size_t chunk_size, const size_t num_chunks);
+            ~ChunkPool();
+
+            const size_t chunk_size;
+            const size_t num_chunks;
+            size_t num_allocated = 0;
+            std::mutex lock;
+            std::vector<void *> free_chunks;
+    };
+}
+
+#endif
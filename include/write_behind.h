@@ -0,0 +1,65 @@
+#ifndef _WRITE_BEHIND_H
+#define _WRITE_BEHIND_H
+
+#include <condition_variable>
+#include "statement.h"
+#include "common.h"
+
+
+namespace GLCC {
+    // Coalesces the writes the detector threads make per event. Items pushed to a batch wait at most
+    // flush_millisecond, or until max_batch_rows are pending, and then go out as one statement
+    // head + item,item,... + tail, a multi-row INSERT or an UPDATE over an IN list.
+    class WriteBehind {
+        public:
+            WriteBehind(const WriteBehind &) = delete;
+            WriteBehind(const WriteBehind &&) = delete;
+            const WriteBehind& operator=(const WriteBehind &) = delete;
+            const WriteBehind& operator=(const WriteBehind &&) = delete;
+
+            static WriteBehind & Instance() {
+                static WriteBehind instance;
+                return instance;
+            }
+
+            int init(const long flush_millisecond, const size_t max_batch_rows);
+            // flushes the pending items and waits for the batches in flight, called at shutdown
+            void release();
+
+            // head_params are bound into head once, returns -1 if name is already registered
+            int add(const std::string & name, const std::string & head, const std::string & item,
+                    const std::string & tail="", const sql_params_t & head_params={});
+            // tag names the item in the logs, returns -1 if name is unknown or params don't match item
+            int push(const std::string & name, const sql_params_t & params, const std::string & tag);
+
+        private:
+            WriteBehind() {}
+            ~WriteBehind() {}
+
+            typedef struct batch {
+                std::string name;
+                std::string head;
+                std::string item;
+                std::string tail;
+                int num_params;
+                std::vector<sql_params_t> items;
+                std::vector<std::string> tags;
+            } batch_t;
+
+            std::mutex lock;
+            std::condition_variable flushed;
+            long flush_millisecond = 500;
+            size_t max_batch_rows = 64;
+            bool is_timer_pending = false;
+            bool is_released = false;
+            int num_in_flight = 0;
+            std::unordered_map<std::string, batch_t> batches;
+
+            // moves the items of batch into pending, lock is held by the caller
+            void take_pending(batch_t & batch, std::vector<batch_t> & pending);
+            void flush(std::vector<batch_t> && pending);
+            void schedule_flush();
+    };
+}
+
+#endif
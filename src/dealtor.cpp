@@ -1,13 +1,164 @@
 #include "dealtor.h"
+#include "scheduler.h"
 
 namespace GLCC{
+    void Detector::update_contours(const std::function<void(contour_list_t &)> & edit) {
+        std::lock_guard<std::mutex> lock_guard(contour_lock);
+        std::shared_ptr<const contour_snapshot_t> current = std::atomic_load(&contour_snapshot);
+        std::shared_ptr<contour_snapshot_t> snapshot = std::make_shared<contour_snapshot_t>(*current);
+        edit(snapshot->contour_list);
+        snapshot->version = current->version + 1;
+        std::atomic_store(&contour_snapshot, std::shared_ptr<const contour_snapshot_t>(std::move(snapshot)));
+    }
+
+    void Detector::set_contour(const std::string & name, const std::vector<cv::Point> & contour) {
+        update_contours([&](contour_list_t & contour_list) { contour_list[name] = contour; });
+    }
+
+    void Detector::set_contours(const contour_list_t & contours) {
+        update_contours([&](contour_list_t & contour_list) {
+            for (auto & item : contours) {
+                contour_list[item.first] = item.second;
+            }
+        });
+    }
+
+    void Detector::erase_contour(const std::string & name) {
+        update_contours([&](contour_list_t & contour_list) { contour_list.erase(name); });
+    }
+
+    std::shared_ptr<const contour_snapshot_t> Detector::get_contours() const {
+        return std::atomic_load(&contour_snapshot);
+    }
+
+    int Detector::put_lattice(cv::Mat & frame,
+            const std::vector<cv::Point> & centers,
+            lattice_context_t & context) {
+        auto & zone_state = context.zone_state;
+        auto & is_in_contour = zone_state.is_in_contour;
+        auto & is_into_timing = zone_state.is_into_timing;
+        auto & is_out_timing = zone_state.is_out_timing;
+        auto & into_contour_time_point = zone_state.into_contour_time_point;
+        auto & out_contour_time_point = zone_state.out_contour_time_point;
+        auto & video_save_path = context.video_save_path;
+        auto & lattice = context.lattice;
+
+        // one snapshot per frame, the writers never block this loop
+        std::shared_ptr<const contour_snapshot_t> contours = get_contours();
+        if (lattice.is_stale(contours->version, frame.size())) {
+            lattice.build(contours->contour_list, frame.size(), contours->version);
+            zone_state.remap(lattice.get_previous_ids());
+        }
+        const int num_zones = lattice.size();
+
+        auto time_now = std::chrono::system_clock::now();
+        lattice.locate(centers);
+        for (int zone_id = 0; zone_id < num_zones; zone_id++) {
+            if (lattice.is_occupied(zone_id)) {
+                if (zone_state.num_in_contour == 0 && !is_into_timing[zone_id]) {
+                    is_into_timing[zone_id] = 1;
+                    into_contour_time_point[zone_id] = time_now;
+                }
+                is_out_timing[zone_id] = 0;
+            } else if (!is_out_timing[zone_id]) {
+                is_out_timing[zone_id] = 1;
+                out_contour_time_point[zone_id] = time_now;
+            }
+        }
+
+        for (int zone_id = 0; zone_id < num_zones; zone_id++) {
+            if (!is_into_timing[zone_id]) {
+                continue;
+            }
+            auto time_gap = std::chrono::duration_cast<std::chrono::milliseconds>(time_now - into_contour_time_point[zone_id]);
+            if (time_gap.count() > context.into_recoder_time_gap) {
+                if (!context.is_recording && context.recorder != nullptr) {
+                    if (resource_dir != "") {
+                        time_t now = std::chrono::system_clock::to_time_t(time_now);
+                        video_save_path.clear();
+                        video_save_path.str("");
+                        video_save_path << resource_dir << "/"
+                           << std::put_time(localtime(&now), constants::file_time_format.c_str())
+                           << ".mp4";
+                        context.recorder->start(video_save_path.str());
+                        context.is_recording = true;
+                        context.is_cover_taken = false;
+                        context.record_time_point = time_now;
+                    }
+                }
+                if (!is_in_contour[zone_id]) {
+                    is_in_contour[zone_id] = 1;
+                    zone_state.num_in_contour++;
+                }
+                is_into_timing[zone_id] = 0;
+            }
+        }
+
+        for (int zone_id = 0; zone_id < num_zones; zone_id++) {
+            if (!is_out_timing[zone_id]) {
+                continue;
+            }
+            auto time_gap = std::chrono::duration_cast<std::chrono::microseconds>(time_now - out_contour_time_point[zone_id]);
+            if (time_gap.count() > context.out_recoder_time_gap) {
+                if (is_in_contour[zone_id]) {
+                    is_in_contour[zone_id] = 0;
+                    zone_state.num_in_contour--;
+                }
+                is_into_timing[zone_id] = 0;
+                is_out_timing[zone_id] = 0;
+            }
+        }
+
+        const cv::Scalar color = {0, 0, 255};
+        for (int zone_id = 0; zone_id < num_zones; zone_id++) {
+            if (is_in_contour[zone_id]) {
+                lattice.fill(frame, zone_id, color, 0.1);
+            } else {
+                lattice.outline(frame, zone_id, color, 3);
+            }
+        }
+
+        // the cover is the frame about 1s into the recording, or the last one of a shorter clip
+        if (context.is_recording && !context.is_cover_taken && (zone_state.num_in_contour == 0 || \
+                std::chrono::duration_cast<std::chrono::milliseconds>(time_now - context.record_time_point).count() >= 1000)) {
+            context.recorder->set_cover(frame.clone());
+            context.is_cover_taken = true;
+        }
+
+        if (zone_state.num_in_contour == 0) {
+            release_lattice(context);
+        }
+        return 0;
+    }
+
+    void Detector::release_lattice(lattice_context_t & context) {
+        if (!context.is_recording) {
+            return;
+        }
+        context.recorder->stop();
+        context.is_recording = false;
+    }
+
+    void Detector::make_cover(const std::string & clip_path, const cv::Mat & cover) {
+        if (cover.empty()) {
+            LOG_F(WARNING, "[Detector][Lattice] No cover frame of %s", clip_path.c_str());
+            return;
+        }
+        std::string cover_save_path;
+        int ret = get_cover_path(clip_path, cover_save_path);
+        if (ret == -1) {
+            LOG_F(WARNING, "[Detector][Lattice] Save cover path fail!");
+            return;
+        }
+        write_cover(cover_save_path, cover);
+    }
+
     ObjectDetector::ObjectDetector(const char * model_path, 
                                    const char * device_name, 
                                    const int device_id) {
-        int ret = mmdeploy_detector_create_by_path(model_path, device_name, device_id, &detector);
-        if (ret != MM_SUCCESS) {
-            LOG_F(ERROR, "Create detector failed! Code: %d", (int)ret);
-            state = -1;
+        engine = InferenceService::Instance().acquire(model_path, device_name, device_id);
+        if (engine == nullptr) {
+            LOG_F(ERROR, "Create detector failed!");
             return;
         } 
     }
@@ -15,10 +166,9 @@ namespace GLCC{
     ObjectDetector::ObjectDetector(const std::string & model_path, 
                                    const std::string & device_name, 
                                    const int device_id) {
-        int ret = mmdeploy_detector_create_by_path(model_path.c_str(), device_name.c_str(), device_id, &detector);
-        if (ret != MM_SUCCESS) {
-            LOG_F(ERROR, "Create detector failed! Code: %d", (int)ret);
-            state = -1;
+        engine = InferenceService::Instance().acquire(model_path, device_name, device_id);
+        if (engine == nullptr) {
+            LOG_F(ERROR, "Create detector failed!");
             return;
         } 
     }
@@ -28,37 +178,11 @@ namespace GLCC{
     }
 
     int ObjectDetector::dect(cv::Mat & img, std::vector<Object> & objects, float score_thre) {
-        int ret;
-        mm_mat_t mat{img.data, img.rows, img.cols, 3, MM_BGR, MM_INT8};
-        mm_detect_t * bboxes;
-        int * res_count;
-        ret = mmdeploy_detector_apply(detector, &mat, 1, & bboxes, &res_count);
-        if (ret != MM_SUCCESS) {
-            LOG_F(ERROR, "Apply detector failed! Code: %d", (int)ret);
+        int ret = engine->infer(img, objects, score_thre);
+        if (ret == -1) {
+            LOG_F(ERROR, "Apply detector failed!");
             return -1;
         }
-        for (int obj_id = 0; obj_id < *res_count; obj_id++) {
-            const auto & score = bboxes[obj_id].score;
-            if (score < score_thre) {
-                continue;
-
-            }
-            const auto & box = bboxes[obj_id].bbox;
-            if ((box.right - box.left) < 1 || (box.bottom - box.top) < 1) {
-                continue;
-            }
-            const auto & label_id = bboxes[obj_id].label_id;
-            objects.emplace_back(
-                (cv::Rect_<float>){
-                    box.left, box.top,
-                    box.right  - box.left,
-                    box.bottom - box.top,
-                },
-                label_id,
-                score
-            );
-        }
-        mmdeploy_detector_release_result(bboxes, res_count, 1);
         return 0;
     }
 
@@ -66,10 +190,37 @@ namespace GLCC{
         return Scalar(rand() % 255, rand() % 255, rand() % 255);
     }
 
+    const char * ObjectDetector::get_name() const {
+        return "ObjectDetector";
+    }
+
+    int ObjectDetector::prepare(const Json::Value & extra_config, const int fps) {
+        return 0;
+    }
+
+    int ObjectDetector::annotate(frame_packet_t * packet) {
+        cv::Mat & frame = packet->frame;
+        packet->centers.clear();
+        for (auto & object : packet->objects) {
+            Scalar color = get_color();
+            auto tl = object.rect.tl(); auto br = object.rect.br();
+            auto ctr = (tl + br) / 2;
+            std::string class_name = object.label < (int)class_names.size() ? \
+                class_names[object.label] : std::to_string(object.label);
+            cv::putText(frame, cv::format("%s: %.3f", class_name.c_str(), object.prob), cv::Point(tl.x, tl.y - 5),
+                0, 0.6, cv::Scalar(0, 0, 255), 2, LINE_AA);
+            cv::rectangle(frame, object.rect, color, 2);
+            cv::circle(frame, cv::Point(ctr.x, ctr.y), 10, color, -1);
+            packet->centers.emplace_back(ctr.x, ctr.y);
+        }
+        return 0;
+    }
+
     int ObjectDetector::run(void * args, 
             std::function<void(void *)> cancel_func,
             std::function<void(void *)> deal_func) {
-        int ret, state;
+        int ret, state = 0;
+        const char * name = get_name();
         detector_run_context_t * context = (detector_run_context_t *) args; 
         const std::string video_path = context->video_path;
         const std::string upload_path = context->upload_path;
@@ -78,16 +229,24 @@ namespace GLCC{
         const int into_contour_time_gap_second = extra_config["into_contour_time_gap_second"].asInt();
         const int out_contour_time_gap_second = extra_config["out_contour_time_gap_second"].asInt();
         const bool imshow_result_image = extra_config["imshow_result_image"].asBool();
-        std::vector<std::string> class_names;
+        const Json::Value pipeline_config = extra_config["pipeline"];
+        const Json::Value recorder_config = extra_config["recorder"];
+        const int queue_size = pipeline_config.get("queue_size", 2).asInt();
+        const int decode_drop_mode = parse_drop_mode(pipeline_config["decode"].asString(), OLDEST_DROP);
+        const int infer_drop_mode = parse_drop_mode(pipeline_config["infer"].asString(), BLOCK_DROP);
+        const int annotate_drop_mode = parse_drop_mode(pipeline_config["annotate"].asString(), BLOCK_DROP);
+        MotionGate motion_gate(extra_config["motion_gate"]);
+        DetectIntervalGate interval_gate(extra_config);
+        class_names.clear();
         for (int i = 0; i < (int)extra_config["class_names"].size(); i++) {
-            class_names.emplace_back(extra_config["class_names"].asString());
+            class_names.emplace_back(extra_config["class_names"][i].asString());
         }
+
         // video
-        cv::Mat frame;
         cv::VideoCapture capture;
         ret = capture.open(video_path);
         if (!ret) {
-            LOG_F(ERROR, "[ObjectDetector][Runner] Open %s failed!", video_path.c_str());
+            LOG_F(ERROR, "[%s][Runner] Open %s failed!", name, video_path.c_str());
             if (cancel_func != nullptr) {
                 cancel_func(nullptr);
             }
@@ -99,226 +258,196 @@ namespace GLCC{
         const int width = capture.get(cv::CAP_PROP_FRAME_WIDTH);
         const int height = capture.get(cv::CAP_PROP_FRAME_HEIGHT);
         const int fps = capture.get(cv::CAP_PROP_FPS);
+        const long frame_interval_millisecond = constants::num_millisecond_per_second / std::max(fps, 1);
+        if (context->quota != nullptr) {
+            // what a room without a target fps asks the scheduler for
+            context->quota->stream_fps = fps;
+        }
 
-        // command
-        char command[512] = {0};
-        std::snprintf(command, sizeof(command), \
-            constants::ffmpeg_push_command.c_str(), \
-                width, height, fps, upload_path.c_str());
-        FILE* fp = popen(command, "w");
-
-        if (fp == nullptr) {
-            LOG_F(ERROR, "[ObjectDetector][Runner] Couldn't open process pipe with command: %s", command);
-            state = -1;
+        // encoder, the recorder takes the encoded packets and has to outlive it
+        ClipRecorder recorder(recorder_config.get("pre_event_second", 3).asInt(),
+                              recorder_config.get("queue_size", 256).asInt());
+        StreamEncoder encoder;
+        ret = encoder.open(upload_path, width, height, fps, extra_config["encoder"]);
+        if (ret == -1) {
+            LOG_F(ERROR, "[%s][Runner] Couldn't open encoder to %s", name, upload_path.c_str());
             if (cancel_func != nullptr) {
                 cancel_func(nullptr);
             }
             capture.release();
             cv::destroyAllWindows();
-            pclose(fp);
             return -1;
         }
+        // a clip is reported only once its file is open, so no row points at a missing file
+        ret = recorder.open(encoder.get_codec_parameters(), encoder.get_time_base(),
+            [&deal_func](const std::string & clip_path) {
+                ThumbnailService::Instance().set_recording(clip_path, true);
+                if (deal_func != nullptr) {
+                    std::stringstream clip_path_stream(clip_path);
+                    deal_func(&clip_path_stream);
+                }
+            },
+            [](const std::string & clip_path, const cv::Mat & cover) {
+                make_cover(clip_path, cover);
+                ThumbnailService::Instance().set_recording(clip_path, false);
+            });
+        if (ret == -1) {
+            LOG_F(ERROR, "[%s][Runner] Couldn't open clip recorder", name);
+            if (cancel_func != nullptr) {
+                cancel_func(nullptr);
+            }
+            capture.release();
+            cv::destroyAllWindows();
+            encoder.close();
+            return -1;
+        }
+        encoder.set_packet_func([&recorder](const AVPacket * packet) { recorder.push(packet); });
 
-        LOG_F(INFO, "\n[ObjectDetector][Runner]\n"
+        LOG_F(INFO, "\n[%s][Runner]\n"
             "Read the video from %s: \n"
             "width: %d | height: %d | fps: %d.\n"
-            "Push the video to %s"
+            "Push the video to %s\n"
             "Extra config: %s",
-            video_path.c_str(), 
+            name, video_path.c_str(), 
             width, height, fps, 
             upload_path.c_str(),
             extra_config.toStyledString().c_str());
 
-        // time to recorder
-        int into_recoder_time_gap = into_contour_time_gap_second * 1000;
-        int out_recoder_time_gap = out_contour_time_gap_second * 1000;
-        std::unordered_map<std::string, bool> is_in_contour = {};
-        std::unordered_map<std::string, std::chrono::system_clock::time_point> into_contour_time_point = {};
-        std::unordered_map<std::string, std::chrono::system_clock::time_point> out_contour_time_point = {};
-
-        std::stringstream video_save_path;
-        cv::VideoWriter video_writer;
-        int video_type = (int)capture.get(CAP_PROP_FOURCC);
-
-        for(;;) {
-            ret = capture.read(frame);
+        ret = prepare(extra_config, fps);
+        if (ret == -1) {
+            LOG_F(ERROR, "[%s][Runner] Prepare runner failed!", name);
+            if (cancel_func != nullptr) {
+                cancel_func(nullptr);
+            }
+            capture.release();
+            cv::destroyAllWindows();
+            encoder.close();
+            return -1;
+        }
 
-            if (ret == 0) {
-                break;
+        // time to recorder
+        lattice_context_t lattice_context;
+        lattice_context.into_recoder_time_gap = into_contour_time_gap_second * 1000;
+        lattice_context.out_recoder_time_gap = out_contour_time_gap_second * 1000;
+        lattice_context.recorder = &recorder;
+
+        // decode -> infer -> track / annotate -> encode / push, each stage on its own thread
+        // enough packets for every queue and every stage to hold one
+        long num_frames = 0;
+        FramePool<frame_packet_t> frame_pool(4 * (queue_size + 1), [&](frame_packet_t * packet) {
+            packet->frame.create(height, width, CV_8UC3);
+            packet->objects.reserve(64);
+            packet->centers.reserve(64);
+        });
+        FramePipeline<frame_packet_t> pipeline(
+            [&]() { return frame_pool.acquire(); },
+            [&](frame_packet_t * packet) { frame_pool.release(packet); });
+
+        pipeline.add_stage("decode", [&](frame_packet_t * packet) {
+            if (lifecycle.is_cancelled()) {
+                return (int)STAGE_STOP;
             }
-            if (frame.empty()) {
-                continue;
+            const uchar * frame_data = packet->frame.data;
+            if (!capture.read(packet->frame)) {
+                return (int)STAGE_STOP;
             }
-
-            if (this->state < 1) {
-                break;
-            };
-
-            std::vector<Object> objects;
-            ret = dect(frame, objects, score_thre);
-            if (ret == -1) {
-                LOG_F(ERROR, "[ObjectDetector][Runner] Dect image failed!");
-                state = -1;
-                break;
+            if (packet->frame.data != frame_data) {
+                frame_pool.count_allocation();
             }
-
-            for (auto & object : objects) {
-                Scalar color = get_color();
-                auto tl = object.rect.tl(); auto br = object.rect.br();
-                auto ctr = (tl + br) / 2;
-                cv::putText(frame, cv::format("%s: %.3f", class_names[object.label].c_str(), object.prob), cv::Point(tl.x, tl.y - 5),
-                    0, 0.6, cv::Scalar(0, 0, 255), 2, LINE_AA);
-                cv::rectangle(frame, object.rect, color, 2);
-                cv::circle(frame, cv::Point(ctr.x, ctr.y), 10, color, -1);
+            if (packet->frame.empty()) {
+                // no frame yet, wait one frame interval unless the room is stopped meanwhile
+                lifecycle.wait_cancel(frame_interval_millisecond);
+                return (int)STAGE_SKIP;
             }
-
-            if (is_put_lattice) {
-                auto time_now = std::chrono::system_clock::now();
-                for (auto & item: contour_list) {
-                    auto & name = item.first;
-                    auto & contour = item.second;
-                    int ret = -1;
-                    for (auto & object : objects) {
-                        auto tl = object.rect.tl(); auto br = object.rect.br();
-                        auto ctr = (tl + br) / 2;
-                        ret = cv::pointPolygonTest(contour, ctr, false);
-                        if (ret >= 0) {
-                            break;
-                        }
-                    }
-
-                    if (ret >= 0) {
-                        if (is_in_contour.size() == 0) {
-                            if (into_contour_time_point.find(name) == into_contour_time_point.end()) {
-                                into_contour_time_point[name] = time_now;
-                            }
-                        }
-                        out_contour_time_point.erase(name);
-                    } else {
-                        if (out_contour_time_point.find(name) == out_contour_time_point.end()) {
-                            out_contour_time_point[name] = time_now;
-                        }
-                    }
-                }
-
-                std::vector<std::string> into_erase_key = {};
-                for (auto & item : into_contour_time_point) {
-                    auto & name = item.first;
-                    auto & time_point = item.second;
-                    if (contour_list.find(name) != contour_list.end()) {
-                        auto time_gap = std::chrono::duration_cast<std::chrono::milliseconds>(time_now - time_point);
-                        if (time_gap.count() > into_recoder_time_gap) {
-                            if (!video_writer.isOpened()) {
-                                if (resource_dir != "") {
-                                    time_t now = std::chrono::system_clock::to_time_t(time_now);
-                                    video_save_path.clear();
-                                    video_save_path.str("");
-                                    video_save_path << resource_dir << "/" 
-                                       << std::put_time(localtime(&now), constants::file_time_format.c_str())
-                                       << ".mp4";
-                                    video_writer.open(video_save_path.str(), video_type, fps, frame.size());
-                                    if (deal_func != nullptr) {
-                                        deal_func(&video_save_path);
-                                    }
-                                }
-                            }
-                            is_in_contour[name] = true;
-                            into_erase_key.emplace_back(name);
-                        }
-                    } else {
-                        out_contour_time_point.erase(name);
-                        is_in_contour.erase(name);
-                    }
-                }
-
-                for (auto & name : into_erase_key) {
-                    into_contour_time_point.erase(name);
-                }
-
-                std::vector<std::string> out_erase_key = {};
-                for (auto & item : out_contour_time_point) {
-                    auto & name = item.first;
-                    auto & time_point = item.second;
-                    auto time_gap = std::chrono::duration_cast<std::chrono::microseconds>(time_now - time_point);
-                    if (time_gap.count() > out_recoder_time_gap) {
-                        is_in_contour.erase(name);
-                        into_contour_time_point.erase(name);
-                        out_erase_key.emplace_back(name);
-                    }
-                }
-
-                for (auto & name : out_erase_key) {
-                    out_contour_time_point.erase(name);
-                }
-
-                for (auto & item : contour_list) {
-                    cv::Scalar color = {0, 0, 255};
-                    auto & name = item.first;
-                    auto & contour = item.second;
-                    if (is_in_contour.find(name) != is_in_contour.end()) {
-                        cv::Mat tmp{frame.rows, frame.cols, CV_8UC3, cv::Scalar(0)};
-                        cv::fillPoly(tmp, contour, color, 8);
-                        cv::addWeighted(frame, 0.9, tmp, 0.1, 0, frame);
-                    } else {
-                        cv::polylines(frame, contour, true, color, 3);
-                    }
-                }
-
-                if (video_writer.isOpened()) {
-                    video_writer.write(frame);
-                }
-
-                if (is_in_contour.size() == 0) {
-                    if (video_writer.isOpened()) {
-                        video_writer.release();
-                        std::unordered_map<std::string, std::string> path_parse_results = {};
-                        int ret = parse_path(video_save_path.str(), path_parse_results);
-                        if (ret == -1) {
-                            LOG_F(WARNING, "[ObjectDetector][Runner] Save cover path fail!");
-                        } else {
-                            auto & dirname = path_parse_results["dirname"];
-                            auto & stem = path_parse_results["stem"];
-                            std::string cover_save_path = dirname + "/" + stem + "." + constants::cover_save_suffix;
-                            std::string command = "ffmpeg -y -i " + video_save_path.str() + " -ss 1 -frames:v 1 " + cover_save_path;
-                            system(command.c_str());
-                        }
-                    }
+            packet->frame_id = num_frames++;
+            packet->capture_time = std::chrono::steady_clock::now();
+            return (int)STAGE_PASS;
+        }, queue_size, decode_drop_mode);
+
+        std::vector<Object> last_objects;
+        pipeline.add_stage("infer", [&](frame_packet_t * packet) {
+            if (context->quota != nullptr) {
+                // detect no more often than the fps the scheduler gives the room
+                const int assigned_fps = std::max((int)context->quota->assigned_fps, 1);
+                interval_gate.set_min_detect_interval((fps + assigned_fps - 1) / assigned_fps);
+            }
+            const bool is_interval = interval_gate.check();
+            packet->is_static = is_interval && !motion_gate.check(packet->frame);
+            if (!is_interval || packet->is_static) {
+                // between two detections or static scene, reuse the last detections
+                packet->is_dect = false;
+                packet->objects = last_objects;
+                if (packet->is_static) {
+                    num_static_inferences++;
+                } else {
+                    num_skipped_inferences++;
                 }
+                return (int)STAGE_PASS;
             }
-
-            ret = fwrite(frame.data, sizeof(char), frame.total() * frame.elemSize(), fp);
-            if (ret <= 0) {
-                LOG_F(ERROR, "[ObjectDetector][Runner] Write push pipe failed");
-                state = -1;
-                break;
+            packet->is_dect = true;
+            packet->objects.clear();
+            if (dect(packet->frame, packet->objects, score_thre) == -1) {
+                LOG_F(ERROR, "[%s][Runner] Dect image failed!", name);
+                return (int)STAGE_STOP;
             }
+            num_inferences++;
+            last_objects = packet->objects;
+            return (int)STAGE_PASS;
+        }, queue_size, infer_drop_mode);
+
+        pipeline.add_stage("annotate", [&](frame_packet_t * packet) {
+            if (annotate(packet) == -1) {
+                LOG_F(ERROR, "[%s][Runner] Annotate image failed!", name);
+                return (int)STAGE_STOP;
+            }
+            if (is_put_lattice) {
+                put_lattice(packet->frame, packet->centers, lattice_context);
+            }
+            return (int)STAGE_PASS;
+        }, queue_size, annotate_drop_mode);
+
+        pipeline.add_stage("push", [&](frame_packet_t * packet) {
+            cv::Mat & frame = packet->frame;
+            if (encoder.write(frame) == -1) {
+                LOG_F(ERROR, "[%s][Runner] Push frame failed", name);
+                return (int)STAGE_STOP;
+            }
+            interval_gate.update(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - packet->capture_time).count());
             if (imshow_result_image) {
                 cv::imshow(video_path, frame);
-                if (cv::waitKey(10) == ESC) break ;
+                if (cv::waitKey(10) == ESC) {
+                    return (int)STAGE_STOP;
+                }
             }
+            return (int)STAGE_PASS;
+        });
+
+        ret = pipeline.run();
+        if (ret == -1) {
+            state = -1;
+        }
+        for (size_t i = 0; i < pipeline.get_num_stages(); i++) {
+            LOG_F(INFO, "[%s][Runner] Stage %s processed: %lu, dropped: %lu", name,
+                pipeline.get_stage_name(i).c_str(),
+                (unsigned long)pipeline.get_num_processed(i),
+                (unsigned long)pipeline.get_num_dropped(i));
         }
+        LOG_F(INFO, "[%s][Runner] Frame pool size: %lu, allocations after preallocation: %lu", name,
+            (unsigned long)frame_pool.get_size(), (unsigned long)frame_pool.get_num_allocations());
+        LOG_F(INFO, "[%s][Runner] Inferences: %lu, skipped: %lu, static: %lu, detect interval: %d, latency: %ldus", name,
+            (unsigned long)num_inferences, (unsigned long)num_skipped_inferences, (unsigned long)num_static_inferences,
+            interval_gate.get_detect_interval(), interval_gate.get_latency_microsecond());
 
         if (cancel_func != nullptr) {
             cancel_func(nullptr);
         }
         capture.release();
         cv::destroyAllWindows();
-
-        if (video_writer.isOpened()) {
-            video_writer.release();
-            std::unordered_map<std::string, std::string> path_parse_results = {};
-            int ret = parse_path(video_save_path.str(), path_parse_results);
-            if (ret == -1) {
-                LOG_F(WARNING, "[TrackerDetector][Runner] Save cover path fail!");
-            } else {
-                auto & dirname = path_parse_results["dirname"];
-                auto & stem = path_parse_results["stem"];
-                std::string cover_save_path = dirname + "/" + stem + "." + constants::cover_save_suffix;
-                std::string command = "ffmpeg -y -i " + video_save_path.str() + " -ss 1 -frames:v 1 " + cover_save_path;
-                system(command.c_str());
-            }
-        }
-        pclose(fp);
+        release_lattice(lattice_context);
+        encoder.close();
+        recorder.close();
+        LOG_F(INFO, "[%s][Runner] Clip packets dropped: %lu", name, (unsigned long)recorder.get_num_dropped());
         return state;
     }
 
@@ -328,7 +457,12 @@ namespace GLCC{
         std::string device_name = params["device"].asString();
         const int device_id = params["device_id"].asInt();
         std::string resource_dir = params["resource_dir"].asString();
-        return new ObjectDetector(model_path, device_name, device_id);
+        ObjectDetector * detector = new ObjectDetector(model_path, device_name, device_id);
+        if (detector->engine == nullptr) {
+            delete detector;
+            return nullptr;
+        }
+        return detector;
     }
 
 
@@ -347,310 +481,47 @@ namespace GLCC{
     }
 
     int TrackerDetector::dect(cv::Mat & img, std::vector<Object> & objects, float score_thre) {
-        int ret;
-        mm_mat_t mat{img.data, img.rows, img.cols, 3, MM_BGR, MM_INT8};
-        mm_detect_t * bboxes;
-        int * res_count;
-        ret = mmdeploy_detector_apply(detector, &mat, 1, & bboxes, &res_count);
-        if (ret != MM_SUCCESS) {
-            LOG_F(ERROR, "[TrackerDetector][DECT] Apply detector failed! Code: %d", (int)ret);
+        int ret = engine->infer(img, objects, score_thre);
+        if (ret == -1) {
+            LOG_F(ERROR, "[TrackerDetector][DECT] Apply detector failed!");
             return -1;
         }
-        for (int obj_id = 0; obj_id < *res_count; obj_id++) {
-            const auto & score = bboxes[obj_id].score;
-            if (score < score_thre) {
-                continue;
-
-            }
-            const auto & box = bboxes[obj_id].bbox;
-            if ((box.right - box.left) < 1 || (box.bottom - box.top) < 1) {
-                continue;
-            }
-            const auto & label_id = bboxes[obj_id].label_id;
-            objects.emplace_back(
-                (cv::Rect_<float>){
-                    box.left, box.top,
-                    box.right  - box.left,
-                    box.bottom - box.top,
-                },
-                label_id,
-                score
-            );
-        }
-        mmdeploy_detector_release_result(bboxes, res_count, 1);
         return 0;
     }
 
-    int TrackerDetector::run(void * args, 
-            std::function<void (void *)> cancel_func,
-            std::function<void (void *)> deal_func) {
-        int ret, state;
-        detector_run_context_t * context = (detector_run_context_t *) args; 
-        const std::string video_path = context->video_path;
-        const std::string upload_path = context->upload_path;
-        const Json::Value extra_config = context->vis_params;
-        const float score_thre = extra_config["score_thre"].asFloat();
-        const int tracker_buffer = extra_config["tracker_buffer"].asInt();
-        const int into_contour_time_gap_second = extra_config["into_contour_time_gap_second"].asInt();
-        const int out_contour_time_gap_second = extra_config["out_contour_time_gap_second"].asInt();
-        const bool imshow_result_image = extra_config["imshow_result_image"].asBool();
-        const float wh_ratio_thre_to_show = extra_config["wh_ratio_thre_to_show"].asFloat();
-        const float wh_multiply_thre_to_show = extra_config["wh_multiply_thre_to_show"].asFloat();
-        std::vector<std::string> class_names;
-        for (int i = 0; i < (int)extra_config["class_names"].size(); i++) {
-            class_names.emplace_back(extra_config["class_names"][i].asString());
-        }
-
-        // video
-        cv::Mat frame;
-        cv::VideoCapture capture;
-        ret = capture.open(video_path);
-        if (!ret) {
-            LOG_F(ERROR, "[TrackerDetector][Runner] Open %s failed!", video_path.c_str());
-            if (cancel_func != nullptr) {
-                cancel_func(nullptr);
-            }
-            capture.release();
-            cv::destroyAllWindows();
-            return -1;
-        }
-
-        const int width = capture.get(cv::CAP_PROP_FRAME_WIDTH);
-        const int height = capture.get(cv::CAP_PROP_FRAME_HEIGHT);
-        const int fps = capture.get(cv::CAP_PROP_FPS);
-
-        // command
-        char command[512] = {0};
-        std::snprintf(command, sizeof(command), \
-            constants::ffmpeg_push_command.c_str(), \
-                width, height, fps, upload_path.c_str());
-        FILE* fp = popen(command, "w");
-
-        if (fp == nullptr) {
-            LOG_F(ERROR, "[TrackerDetector][Runner] Couldn't open process pipe with command: %s", command);
-            state = -1;
-            if (cancel_func != nullptr) {
-                cancel_func(nullptr);
-            }
-            capture.release();
-            cv::destroyAllWindows();
-            pclose(fp);
-            return -1;
-        }
-
-        LOG_F(INFO, "\n[TrackerDetector][Runner]\n"
-            "Read the video from %s: \n"
-            "width: %d | height: %d | fps: %d.\n"
-            "Push the video to %s\n"
-            "Extra config: %s",
-            video_path.c_str(), 
-            width, height, fps, 
-            upload_path.c_str(),
-            extra_config.toStyledString().c_str());
+    const char * TrackerDetector::get_name() const {
+        return "TrackerDetector";
+    }
 
+    int TrackerDetector::prepare(const Json::Value & extra_config, const int fps) {
+        const int tracker_buffer = extra_config["tracker_buffer"].asInt();
+        wh_ratio_thre_to_show = extra_config["wh_ratio_thre_to_show"].asFloat();
+        wh_multiply_thre_to_show = extra_config["wh_multiply_thre_to_show"].asFloat();
         // byteTracker
-        BYTETracker tracker(fps, tracker_buffer);
-        int num_frames = 0;
-
-        // time to recorder
-        int into_recoder_time_gap = into_contour_time_gap_second * 1000;
-        int out_recoder_time_gap = out_contour_time_gap_second * 1000;
-        std::unordered_map<std::string, bool> is_in_contour = {};
-        std::unordered_map<std::string, std::chrono::system_clock::time_point> into_contour_time_point = {};
-        std::unordered_map<std::string, std::chrono::system_clock::time_point> out_contour_time_point = {};
-
-        std::stringstream video_save_path;
-        cv::VideoWriter video_writer;
-        int video_type = (int)capture.get(CAP_PROP_FOURCC);
-
-        for(;;) {
-            ret = capture.read(frame);
-            num_frames++;
-
-            if (ret == 0) {
-                break;
-            }
-            if (frame.empty()) {
-                continue;
-            }
-
-            if (this->state < 1) {
-                break;
-            };
-
-            std::vector<Object> objects;
-            ret = dect(frame, objects, score_thre);
-            if (ret == -1) {
-                LOG_F(ERROR, "[TrackerDetector][Runner] Dect image failed!");
-                state = -1;
-                break;
-            }
-
-            std::vector<STrack> stracks = tracker.update(objects);
-            std::vector<STrack> stracks_show;
-
-            for (auto & strack : stracks) {
-                auto & tlwh = strack.tlwh;
-                auto xyah = strack.to_xyah();
-                bool wh_ratio = tlwh[2] / tlwh[3] > wh_ratio_thre_to_show;
-                if (tlwh[2] * tlwh[3] > wh_multiply_thre_to_show && !wh_ratio) {
-                    stracks_show.emplace_back(strack);
-                    Scalar color = tracker.get_color(strack.track_id);
-                    cv::putText(frame, cv::format("id:%d: %.3f", strack.track_id, strack.score), cv::Point(tlwh[0], tlwh[1] - 5),
-                        0, 0.6, cv::Scalar(0, 0, 255), 2, LINE_AA);
-                    cv::rectangle(frame, cv::Rect(tlwh[0], tlwh[1], tlwh[2], tlwh[3]), color, 2);
-                    cv::circle(frame, cv::Point(xyah[0], xyah[1]), 10, color, -1);
-                }
-            }
-
-            if (is_put_lattice) {
-                auto time_now = std::chrono::system_clock::now();
-                for (auto & item: contour_list) {
-                    auto & name = item.first;
-                    auto & contour = item.second;
-                    int ret = -1;
-                    for (auto & strack : stracks_show) {
-                        auto xyah = strack.to_xyah();
-                        cv::Point ctr(xyah[0], xyah[1]);
-                        ret = cv::pointPolygonTest(contour, ctr, false);
-                        if (ret >= 0) {
-                            break;
-                        }
-                    }
-
-                    if (ret >= 0) {
-                        if (is_in_contour.size() == 0) {
-                            if (into_contour_time_point.find(name) == into_contour_time_point.end()) {
-                                into_contour_time_point[name] = time_now;
-                            }
-                        }
-                        out_contour_time_point.erase(name);
-                    } else {
-                        if (out_contour_time_point.find(name) == out_contour_time_point.end()) {
-                            out_contour_time_point[name] = time_now;
-                        }
-                    }
-                }
-
-                std::vector<std::string> into_erase_key = {};
-                for (auto & item : into_contour_time_point) {
-                    auto & name = item.first;
-                    auto & time_point = item.second;
-                    if (contour_list.find(name) != contour_list.end()) {
-                        auto time_gap = std::chrono::duration_cast<std::chrono::milliseconds>(time_now - time_point);
-                        if (time_gap.count() > into_recoder_time_gap) {
-                            if (!video_writer.isOpened()) {
-                                if (resource_dir != "") {
-                                    time_t now = std::chrono::system_clock::to_time_t(time_now);
-                                    video_save_path.clear();
-                                    video_save_path.str("");
-                                    video_save_path << resource_dir << "/" 
-                                       << std::put_time(localtime(&now), constants::file_time_format.c_str())
-                                       << ".mp4";
-                                    video_writer.open(video_save_path.str(), video_type, fps, frame.size());
-                                    if (deal_func != nullptr && video_writer.isOpened()) {
-                                        deal_func(&video_save_path);
-                                    }
-                                }
-                            }
-                            is_in_contour[name] = true;
-                            into_erase_key.emplace_back(name);
-                        }
-                    } else {
-                        out_contour_time_point.erase(name);
-                        is_in_contour.erase(name);
-                    }
-                }
-
-                for (auto & name : into_erase_key) {
-                    into_contour_time_point.erase(name);
-                }
-
-                std::vector<std::string> out_erase_key = {};
-                for (auto & item : out_contour_time_point) {
-                    auto & name = item.first;
-                    auto & time_point = item.second;
-                    auto time_gap = std::chrono::duration_cast<std::chrono::microseconds>(time_now - time_point);
-                    if (time_gap.count() > out_recoder_time_gap) {
-                        is_in_contour.erase(name);
-                        into_contour_time_point.erase(name);
-                        out_erase_key.emplace_back(name);
-                    }
-                }
-
-                for (auto & name : out_erase_key) {
-                    out_contour_time_point.erase(name);
-                }
-
-                for (auto & item : contour_list) {
-                    cv::Scalar color = {0, 0, 255};
-                    auto & name = item.first;
-                    auto & contour = item.second;
-                    if (is_in_contour.find(name) != is_in_contour.end()) {
-                        cv::Mat tmp{frame.rows, frame.cols, CV_8UC3, cv::Scalar(0)};
-                        cv::fillPoly(tmp, contour, color, 8);
-                        cv::addWeighted(frame, 0.9, tmp, 0.1, 0, frame);
-                    } else {
-                        cv::polylines(frame, contour, true, color, 3);
-                    }
-                }
-
-                if (video_writer.isOpened()) {
-                    video_writer.write(frame);
-                }
-
-                if (is_in_contour.size() == 0) {
-                    if (video_writer.isOpened()) {
-                        video_writer.release();
-                        std::unordered_map<std::string, std::string> path_parse_results = {};
-                        int ret = parse_path(video_save_path.str(), path_parse_results);
-                        if (ret == -1) {
-                            LOG_F(WARNING, "[TrackerDetector][Runner] Save cover path fail!");
-                        } else {
-                            auto & dirname = path_parse_results["dirname"];
-                            auto & stem = path_parse_results["stem"];
-                            std::string cover_save_path = dirname + "/" + stem + "." + constants::cover_save_suffix;
-                            std::string command = "ffmpeg -y -i " + video_save_path.str() + " -ss 1 -frames:v 1 " + cover_save_path;
-                            system(command.c_str());
-                        }
-                    }
-                }
-            }
-
-            ret = fwrite(frame.data, sizeof(char), frame.total() * frame.elemSize(), fp);
-            if (ret <= 0) {
-                LOG_F(ERROR, "[TrackerDetector][Runner] Write push pipe failed");
-                state = -1;
-                break;
-            }
-            if (imshow_result_image) {
-                cv::imshow(video_path, frame);
-                if (cv::waitKey(10) == ESC) break ;
-            }
-        }
-
-        if (cancel_func != nullptr) {
-            cancel_func(nullptr);
-        }
-        capture.release();
-        cv::destroyAllWindows();
+        tracker.reset(new BYTETracker(fps, tracker_buffer));
+        return 0;
+    }
 
-        if (video_writer.isOpened()) {
-            video_writer.release();
-            std::unordered_map<std::string, std::string> path_parse_results = {};
-            int ret = parse_path(video_save_path.str(), path_parse_results);
-            if (ret == -1) {
-                LOG_F(WARNING, "[TrackerDetector][Runner] Save cover path fail!");
-            } else {
-                auto & dirname = path_parse_results["dirname"];
-                auto & stem = path_parse_results["stem"];
-                std::string cover_save_path = dirname + "/" + stem + "." + constants::cover_save_suffix;
-                std::string command = "ffmpeg -y -i " + video_save_path.str() + " -ss 1 -frames:v 1 " + cover_save_path;
-                system(command.c_str());
+    int TrackerDetector::annotate(frame_packet_t * packet) {
+        cv::Mat & frame = packet->frame;
+        // without detections, keep the tracks moving by the kalman filter
+        std::vector<STrack> stracks = packet->is_dect ? \
+            tracker->update(packet->objects) : tracker->predict(packet->is_static);
+        packet->centers.clear();
+        for (auto & strack : stracks) {
+            auto & tlwh = strack.tlwh;
+            auto xyah = strack.to_xyah();
+            bool wh_ratio = tlwh[2] / tlwh[3] > wh_ratio_thre_to_show;
+            if (tlwh[2] * tlwh[3] > wh_multiply_thre_to_show && !wh_ratio) {
+                Scalar color = tracker->get_color(strack.track_id);
+                cv::putText(frame, cv::format("id:%d: %.3f", strack.track_id, strack.score), cv::Point(tlwh[0], tlwh[1] - 5),
+                    0, 0.6, cv::Scalar(0, 0, 255), 2, LINE_AA);
+                cv::rectangle(frame, cv::Rect(tlwh[0], tlwh[1], tlwh[2], tlwh[3]), color, 2);
+                cv::circle(frame, cv::Point(xyah[0], xyah[1]), 10, color, -1);
+                packet->centers.emplace_back(xyah[0], xyah[1]);
             }
         }
-        pclose(fp);
-        return state;
+        return 0;
     }
 
     Detector * TrackerDetector::init_func(void * args) {
@@ -658,7 +529,12 @@ namespace GLCC{
         std::string model_path = params["model"].asString();
         std::string device_name = params["device"].asString();
         const int device_id = params["device_id"].asInt();
-        return new TrackerDetector(model_path, device_name, device_id);
+        TrackerDetector * detector = new TrackerDetector(model_path, device_name, device_id);
+        if (detector->engine == nullptr) {
+            delete detector;
+            return nullptr;
+        }
+        return detector;
     } 
 
 }
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "encoder.h"
+
+namespace GLCC {
+    static std::string av_error_string(const int errnum) {
+        char buf[AV_ERROR_MAX_STRING_SIZE] = {0};
+        av_strerror(errnum, buf, sizeof(buf));
+        return buf;
+    }
+
+    StreamEncoder::~StreamEncoder() {
+        close();
+    }
+
+    int StreamEncoder::open(const std::string & url,
+                            const int width,
+                            const int height,
+                            const int fps,
+                            const Json::Value & encoder_config) {
+        static std::once_flag network_init_flag;
+        std::call_once(network_init_flag, []() { avformat_network_init(); });
+
+        int ret;
+        this->url = url;
+        const std::string codec_name = encoder_config.get("codec", "libx264").asString();
+        const std::string preset = encoder_config.get("preset", "ultrafast").asString();
+        const std::string tune = encoder_config.get("tune", "zerolatency").asString();
+        const int threads = encoder_config.get("threads", 1).asInt();
+        const int frame_rate = fps > 0 ? fps : 25;
+        const int gop = encoder_config.get("gop", frame_rate * 2).asInt();
+        const int64_t bit_rate = encoder_config.get("bit_rate", 0).asInt64();
+
+        ret = avformat_alloc_output_context2(&format_context, nullptr, "flv", url.c_str());
+        if (ret < 0 || format_context == nullptr) {
+            LOG_F(ERROR, "[StreamEncoder] Alloc output context for %s failed: %s", url.c_str(), av_error_string(ret).c_str());
+            release();
+            return -1;
+        }
+
+        const AVCodec * codec = avcodec_find_encoder_by_name(codec_name.c_str());
+        if (codec == nullptr) {
+            LOG_F(ERROR, "[StreamEncoder] Couldn't find encoder %s", codec_name.c_str());
+            release();
+            return -1;
+        }
+        codec_context = avcodec_alloc_context3(codec);
+        codec_context->width = width;
+        codec_context->height = height;
+        codec_context->pix_fmt = AV_PIX_FMT_YUV420P;
+        codec_context->time_base = AVRational{1, frame_rate};
+        codec_context->framerate = AVRational{frame_rate, 1};
+        codec_context->gop_size = gop;
+        codec_context->max_b_frames = 0;
+        codec_context->thread_count = threads;
+        if (bit_rate > 0) {
+            codec_context->bit_rate = bit_rate;
+        }
+        if (format_context->oformat->flags & AVFMT_GLOBALHEADER) {
+            codec_context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+        }
+        av_opt_set(codec_context->priv_data, "preset", preset.c_str(), 0);
+        if (tune != "") {
+            av_opt_set(codec_context->priv_data, "tune", tune.c_str(), 0);
+        }
+        ret = avcodec_open2(codec_context, codec, nullptr);
+        if (ret < 0) {
+            LOG_F(ERROR, "[StreamEncoder] Open encoder %s failed: %s", codec_name.c_str(), av_error_string(ret).c_str());
+            release();
+            return -1;
+        }
+
+        stream = avformat_new_stream(format_context, nullptr);
+        if (stream == nullptr) {
+            LOG_F(ERROR, "[StreamEncoder] Create stream for %s failed", url.c_str());
+            release();
+            return -1;
+        }
+        stream->time_base = codec_context->time_base;
+        avcodec_parameters_from_context(stream->codecpar, codec_context);
+
+        if (!(format_context->oformat->flags & AVFMT_NOFILE)) {
+            ret = avio_open(&format_context->pb, url.c_str(), AVIO_FLAG_WRITE);
+            if (ret < 0) {
+                LOG_F(ERROR, "[StreamEncoder] Open %s failed: %s", url.c_str(), av_error_string(ret).c_str());
+                release();
+                return -1;
+            }
+        }
+        ret = avformat_write_header(format_context, nullptr);
+        if (ret < 0) {
+            LOG_F(ERROR, "[StreamEncoder] Write header to %s failed: %s", url.c_str(), av_error_string(ret).c_str());
+            release();
+            return -1;
+        }
+
+        yuv_frame = av_frame_alloc();
+        yuv_frame->format = codec_context->pix_fmt;
+        yuv_frame->width = width;
+        yuv_frame->height = height;
+        ret = av_frame_get_buffer(yuv_frame, 0);
+        if (ret < 0) {
+            LOG_F(ERROR, "[StreamEncoder] Alloc frame buffer failed: %s", av_error_string(ret).c_str());
+            release();
+            return -1;
+        }
+        packet = av_packet_alloc();
+        next_pts = 0;
+        LOG_F(INFO, "[StreamEncoder] Push %dx%d@%d to %s, encoder: %s, preset: %s, threads: %d, gop: %d",
+            width, height, frame_rate, url.c_str(), codec_name.c_str(), preset.c_str(), threads, gop);
+        return 0;
+    }
+
+    int StreamEncoder::write(const cv::Mat & frame) {
+        if (!is_opened() || packet == nullptr) {
+            return -1;
+        }
+        // the capture may change resolution on the fly, the cached context is rebuilt only then
+        sws_context = sws_getCachedContext(sws_context,
+            frame.cols, frame.rows, AV_PIX_FMT_BGR24,
+            codec_context->width, codec_context->height, codec_context->pix_fmt,
+            SWS_BILINEAR, nullptr, nullptr, nullptr);
+        if (sws_context == nullptr) {
+            LOG_F(ERROR, "[StreamEncoder] Create scale context failed");
+            return -1;
+        }
+        int ret = av_frame_make_writable(yuv_frame);
+        if (ret < 0) {
+            LOG_F(ERROR, "[StreamEncoder] Make frame writable failed: %s", av_error_string(ret).c_str());
+            return -1;
+        }
+        const uint8_t * src_data[1] = {frame.data};
+        const int src_linesize[1] = {(int)frame.step};
+        sws_scale(sws_context, src_data, src_linesize, 0, frame.rows, yuv_frame->data, yuv_frame->linesize);
+        yuv_frame->pts = next_pts++;
+        return encode(yuv_frame);
+    }
+
+    int StreamEncoder::encode(AVFrame * frame) {
+        int ret = avcodec_send_frame(codec_context, frame);
+        if (ret < 0) {
+            LOG_F(ERROR, "[StreamEncoder] Send frame failed: %s", av_error_string(ret).c_str());
+            return -1;
+        }
+        for (;;) {
+            ret = avcodec_receive_packet(codec_context, packet);
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+                return 0;
+            } else if (ret < 0) {
+                LOG_F(ERROR, "[StreamEncoder] Receive packet failed: %s", av_error_string(ret).c_str());
+                return -1;
+            }
+            if (packet_func != nullptr) {
+                packet_func(packet);
+            }
+            av_packet_rescale_ts(packet, codec_context->time_base, stream->time_base);
+            packet->stream_index = stream->index;
+            ret = av_interleaved_write_frame(format_context, packet);
+            if (ret < 0) {
+                LOG_F(ERROR, "[StreamEncoder] Write packet to %s failed: %s", url.c_str(), av_error_string(ret).c_str());
+                return -1;
+            }
+        }
+    }
+
+    void StreamEncoder::close() {
+        if (!is_opened()) {
+            return;
+        }
+        if (packet != nullptr) {
+            encode(nullptr);
+            av_write_trailer(format_context);
+        }
+        release();
+    }
+
+    void StreamEncoder::release() {
+        if (packet != nullptr) {
+            av_packet_free(&packet);
+        }
+        if (yuv_frame != nullptr) {
+            av_frame_free(&yuv_frame);
+        }
+        if (sws_context != nullptr) {
+            sws_freeContext(sws_context);
+            sws_context = nullptr;
+        }
+        if (codec_context != nullptr) {
+            avcodec_free_context(&codec_context);
+        }
+        if (format_context != nullptr) {
+            if (format_context->pb != nullptr && !(format_context->oformat->flags & AVFMT_NOFILE)) {
+                avio_closep(&format_context->pb);
+            }
+            avformat_free_context(format_context);
+            format_context = nullptr;
+        }
+        stream = nullptr;
+    }
+}
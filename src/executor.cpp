@@ -0,0 +1,148 @@
+#include "executor.h"
+
+namespace GLCC {
+    static const long release_wait_second = 5;
+
+    int parse_pin_policy(const std::string & policy) noexcept {
+        if (policy == "worker") {
+            return WORKER_PIN;
+        } else if (policy == "room") {
+            return ROOM_PIN;
+        }
+        return NO_PIN;
+    }
+
+    int DetectorExecutor::init(const int num_workers, const int pin_policy, const std::vector<int> & cpus) {
+        std::lock_guard<std::mutex> lock_guard(lock);
+        if (!workers.empty()) {
+            return -1;
+        }
+        this->cpus = cpus;
+        this->pin_policy = cpus.empty() ? NO_PIN : pin_policy;
+        sched_getaffinity(0, sizeof(default_cpu_set), &default_cpu_set);
+        stopping = false;
+        for (int i = 0; i < std::max(num_workers, 1); i++) {
+            std::unique_ptr<worker_t> worker(new worker_t);
+            worker->thread = std::thread(&DetectorExecutor::run, this, i);
+            workers.emplace_back(std::move(worker));
+        }
+        LOG_F(INFO, "[Executor] Start %d workers, pin policy: %d on %d cpus",
+            std::max(num_workers, 1), this->pin_policy, (int)cpus.size());
+        return 0;
+    }
+
+    void DetectorExecutor::release() {
+        std::unique_lock<std::mutex> unique_lock(lock);
+        stopping = true;
+        for (auto & job : jobs) {
+            LOG_F(WARNING, "[Executor][%s] Drop the queued room", job.room_name.c_str());
+        }
+        jobs.clear();
+        cond.notify_all();
+        bool is_exited = cond.wait_for(unique_lock, std::chrono::seconds(release_wait_second), [this]() {
+            return std::all_of(workers.begin(), workers.end(),
+                [](const std::unique_ptr<worker_t> & worker) { return worker->exited; });
+        });
+        std::vector<std::unique_ptr<worker_t>> released;
+        released.swap(workers);
+        unique_lock.unlock();
+        for (auto & worker : released) {
+            if (worker->exited) {
+                worker->thread.join();
+            } else {
+                // the worker keeps the executor alive until its room returns
+                LOG_F(WARNING, "[Executor][%s] Room still running at release", worker->room_name.c_str());
+                worker->thread.detach();
+                worker.release();
+            }
+        }
+        if (!is_exited) {
+            LOG_F(WARNING, "[Executor] Release with running rooms");
+        }
+    }
+
+    int DetectorExecutor::submit(const std::string & room_name, std::function<void()> func, std::function<void()> done_func) {
+        std::lock_guard<std::mutex> lock_guard(lock);
+        if (stopping || workers.empty()) {
+            return -1;
+        }
+        size_t num_idle = std::count_if(workers.begin(), workers.end(),
+            [](const std::unique_ptr<worker_t> & worker) { return worker->room_name.empty(); });
+        // the jobs only hand the rooms over to the idle workers, they never wait for a busy one
+        if (jobs.size() >= num_idle) {
+            LOG_F(WARNING, "[Executor][%s] Every worker is busy", room_name.c_str());
+            return -1;
+        }
+        jobs.push_back(room_job_t{room_name, std::move(func), std::move(done_func)});
+        cond.notify_all();
+        return 0;
+    }
+
+    std::vector<std::string> DetectorExecutor::get_running_rooms() {
+        std::lock_guard<std::mutex> lock_guard(lock);
+        std::vector<std::string> room_names;
+        for (auto & worker : workers) {
+            if (!worker->room_name.empty()) {
+                room_names.emplace_back(worker->room_name);
+            }
+        }
+        return room_names;
+    }
+
+    int DetectorExecutor::get_num_workers() {
+        std::lock_guard<std::mutex> lock_guard(lock);
+        return (int)workers.size();
+    }
+
+    void DetectorExecutor::pin(const int cpu) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(cpu, &cpu_set);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0) {
+            LOG_F(WARNING, "[Executor] Pin to cpu %d fail!", cpu);
+        }
+    }
+
+    void DetectorExecutor::unpin() {
+        pthread_setaffinity_np(pthread_self(), sizeof(default_cpu_set), &default_cpu_set);
+    }
+
+    void DetectorExecutor::run(const int index) {
+        if (pin_policy == WORKER_PIN) {
+            pin(cpus[index % cpus.size()]);
+        }
+        std::unique_lock<std::mutex> unique_lock(lock);
+        worker_t * worker = workers[index].get();
+        for (;;) {
+            cond.wait(unique_lock, [this]() { return stopping || !jobs.empty(); });
+            if (stopping) {
+                break;
+            }
+            room_job_t job = std::move(jobs.front());
+            jobs.pop_front();
+            worker->room_name = job.room_name;
+            unique_lock.unlock();
+
+            if (pin_policy == ROOM_PIN) {
+                pin(cpus[std::hash<std::string>()(job.room_name) % cpus.size()]);
+            }
+            LOG_F(INFO, "[Executor][%s] Run on worker %d", job.room_name.c_str(), index);
+            job.func();
+            LOG_F(INFO, "[Executor][%s] Worker %d is free", job.room_name.c_str(), index);
+            if (pin_policy == ROOM_PIN) {
+                unpin();
+            }
+
+            unique_lock.lock();
+            worker->room_name.clear();
+            if (job.done_func) {
+                // the worker is free by now, a room started by done_func can take it
+                unique_lock.unlock();
+                job.done_func();
+                unique_lock.lock();
+            }
+        }
+        worker->exited = true;
+        cond.notify_all();
+    }
+}
@@ -0,0 +1,141 @@
+#include "expiry.h"
+
+namespace GLCC {
+    static const long load_retry_second = 10;
+
+    std::string ExpiryService::due_key(const expiry_entry_t & entry) {
+        // room names are unique, a file is keyed like its row
+        if (entry.kind == ROOM_EXPIRY) {
+            return "room/" + entry.name;
+        }
+        return "file/" + entry.user_name + "/" + entry.video_name + "/" + entry.name;
+    }
+
+    void ExpiryService::set_handler(const int kind, expiry_handler_t handler) {
+        std::lock_guard<std::mutex> lock_guard(lock);
+        if (kind >= 0 && kind < NUM_EXPIRY_KINDS) {
+            handlers[kind] = std::move(handler);
+        }
+    }
+
+    void ExpiryService::set_loader(expiry_loader_t loader) {
+        std::lock_guard<std::mutex> lock_guard(lock);
+        this->loader = std::move(loader);
+    }
+
+    int ExpiryService::init(const long load_window_second, const size_t max_batch_rows) {
+        std::lock_guard<std::mutex> lock_guard(lock);
+        if (worker.joinable()) {
+            return -1;
+        }
+        this->load_window_second = std::max(load_window_second, 2L);
+        this->max_batch_rows = std::max(max_batch_rows, (size_t)1);
+        loaded_second = 0;
+        next_load_second = 0;
+        stopping = false;
+        worker = std::thread(&ExpiryService::run, this);
+        LOG_F(INFO, "[Expiry] Load every %ld s, delete %zu rows at most at a time",
+            this->load_window_second / 2, this->max_batch_rows);
+        return 0;
+    }
+
+    void ExpiryService::release() {
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            stopping = true;
+        }
+        cond.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+        std::lock_guard<std::mutex> lock_guard(lock);
+        entries = decltype(entries)();
+        due_seconds.clear();
+    }
+
+    void ExpiryService::push(expiry_entry_t && entry) {
+        if (entry.kind < 0 || entry.kind >= NUM_EXPIRY_KINDS) {
+            return;
+        }
+        const std::string key = due_key(entry);
+        std::lock_guard<std::mutex> lock_guard(lock);
+        if (entry.end_second >= loaded_second) {
+            // a refreshed row moves out of the window, its queued entry goes stale
+            due_seconds.erase(key);
+            return;
+        }
+        auto iter = due_seconds.find(key);
+        if (iter != due_seconds.end() && iter->second == entry.end_second) {
+            return;
+        }
+        const bool is_earliest = entries.empty() || entry.end_second < entries.top().end_second;
+        due_seconds[key] = entry.end_second;
+        entries.push(std::move(entry));
+        if (is_earliest) {
+            cond.notify_one();
+        }
+    }
+
+    void ExpiryService::retry_load(const long long from_second) {
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            loaded_second = std::min(loaded_second, from_second);
+            next_load_second = std::min(next_load_second, (long long)time(nullptr) + load_retry_second);
+        }
+        LOG_F(WARNING, "[Expiry] Load from %lld fail, retry in %ld s", from_second, load_retry_second);
+        cond.notify_one();
+    }
+
+    void ExpiryService::run() {
+        std::unique_lock<std::mutex> unique_lock(lock);
+        while (!stopping) {
+            const long long now_second = time(nullptr);
+            if (now_second >= next_load_second) {
+                const long long from_second = loaded_second;
+                loaded_second = now_second + load_window_second;
+                next_load_second = now_second + load_window_second / 2;
+                expiry_loader_t load = loader;
+                const long long to_second = loaded_second;
+                unique_lock.unlock();
+                if (load) {
+                    load(from_second, to_second);
+                }
+                unique_lock.lock();
+                continue;
+            }
+
+            std::vector<expiry_entry_t> due[NUM_EXPIRY_KINDS];
+            bool is_due = false;
+            while (!entries.empty() && entries.top().end_second <= now_second) {
+                expiry_entry_t entry = entries.top();
+                entries.pop();
+                auto iter = due_seconds.find(due_key(entry));
+                if (iter == due_seconds.end() || iter->second != entry.end_second) {
+                    continue;
+                }
+                due_seconds.erase(iter);
+                due[entry.kind].push_back(std::move(entry));
+                is_due = true;
+            }
+            if (is_due) {
+                std::vector<expiry_handler_t> handle(handlers, handlers + NUM_EXPIRY_KINDS);
+                unique_lock.unlock();
+                for (int kind = 0; kind < NUM_EXPIRY_KINDS; kind++) {
+                    for (size_t begin = 0; begin < due[kind].size() && handle[kind]; begin += max_batch_rows) {
+                        auto first = due[kind].begin() + begin;
+                        auto last = due[kind].begin() + std::min(begin + max_batch_rows, due[kind].size());
+                        handle[kind](std::vector<expiry_entry_t>(std::make_move_iterator(first), std::make_move_iterator(last)));
+                    }
+                }
+                unique_lock.lock();
+                continue;
+            }
+
+            long long wake_second = next_load_second;
+            if (!entries.empty()) {
+                wake_second = std::min(wake_second, entries.top().end_second);
+            }
+            cond.wait_until(unique_lock, std::chrono::system_clock::from_time_t((time_t)wake_second));
+        }
+    }
+}
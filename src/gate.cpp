@@ -0,0 +1,85 @@
+#include "gate.h"
+
+namespace GLCC {
+    MotionGate::MotionGate(const bool enable,
+                           const int scale_width,
+                           const int pixel_thre,
+                           const float motion_thre,
+                           const int refresh_interval):
+        enable(enable), scale_width(scale_width > 0 ? scale_width : 160), pixel_thre(pixel_thre),
+        motion_thre(motion_thre), refresh_interval(refresh_interval > 0 ? refresh_interval : 1) {}
+
+    MotionGate::MotionGate(const Json::Value & config):
+        MotionGate(config.get("enable", false).asBool(),
+                   config.get("scale_width", 160).asInt(),
+                   config.get("pixel_thre", 25).asInt(),
+                   config.get("motion_thre", 0.002).asFloat(),
+                   config.get("refresh_interval", 50).asInt()) {}
+
+    bool MotionGate::check(const cv::Mat & frame) {
+        if (!enable || frame.empty()) {
+            return true;
+        }
+        const int scale_height = std::max(1, frame.rows * scale_width / std::max(1, frame.cols));
+        cv::resize(frame, small, cv::Size(scale_width, scale_height), 0, 0, cv::INTER_AREA);
+        cv::cvtColor(small, gray, cv::COLOR_BGR2GRAY);
+
+        num_frames_from_refresh++;
+        bool is_motion = false;
+        if (reference.empty() || reference.size() != gray.size() || num_frames_from_refresh >= refresh_interval) {
+            is_motion = true;
+        } else {
+            cv::absdiff(gray, reference, diff);
+            cv::threshold(diff, diff, pixel_thre, 255, cv::THRESH_BINARY);
+            float motion_ratio = (float)cv::countNonZero(diff) / (float)diff.total();
+            is_motion = motion_ratio > motion_thre;
+        }
+
+        if (is_motion) {
+            cv::swap(gray, reference);
+            num_frames_from_refresh = 0;
+        }
+        return is_motion;
+    }
+
+    DetectIntervalGate::DetectIntervalGate(const long latency_budget_millisecond,
+                                           const int max_detect_interval,
+                                           const int adjust_period):
+        latency_budget_microsecond(latency_budget_millisecond > 0 ? latency_budget_millisecond * 1000 : 0),
+        max_detect_interval(max_detect_interval > 0 ? max_detect_interval : 1),
+        adjust_period(adjust_period > 0 ? adjust_period : 1) {}
+
+    DetectIntervalGate::DetectIntervalGate(const Json::Value & extra_config):
+        DetectIntervalGate(extra_config.get("latency_budget_millisecond", 0).asInt64(),
+                           extra_config.get("max_detect_interval", 1).asInt()) {}
+
+    bool DetectIntervalGate::check() {
+        if (++num_frames_from_dect < std::max((int)detect_interval, min_detect_interval)) {
+            return false;
+        }
+        num_frames_from_dect = 0;
+        return true;
+    }
+
+    void DetectIntervalGate::update(const long latency_microsecond) {
+        if (latency_budget_microsecond == 0) {
+            return;
+        }
+        latency_ema = latency_ema == 0 ? latency_microsecond : 0.9 * latency_ema + 0.1 * latency_microsecond;
+        if (++num_frames_from_adjust < adjust_period) {
+            return;
+        }
+        int interval = detect_interval;
+        if (latency_ema > latency_budget_microsecond) {
+            interval = std::min(interval * 2, max_detect_interval);
+        } else if (latency_ema < 0.8 * latency_budget_microsecond) {
+            interval = std::max(interval - 1, 1);
+        }
+        if (interval != detect_interval) {
+            LOG_F(INFO, "[DetectIntervalGate] Latency: %.1fms, budget: %ldms, detect interval: %d -> %d",
+                latency_ema / 1000, latency_budget_microsecond / 1000, (int)detect_interval, interval);
+            detect_interval = interval;
+        }
+        num_frames_from_adjust = 0;
+    }
+}
@@ -0,0 +1,273 @@
+#include "inference.h"
+
+namespace GLCC {
+    InferenceEngine::InferenceEngine(const std::string & model_path,
+                                     const std::string & device_name,
+                                     const int device_id,
+                                     const int max_batch_size,
+                                     const long max_wait_microsecond):
+            max_batch_size(max_batch_size > 0 ? max_batch_size : 1),
+            max_wait_microsecond(max_wait_microsecond > 0 ? max_wait_microsecond : 0) {
+        int ret = mmdeploy_detector_create_by_path(model_path.c_str(), device_name.c_str(), device_id, &handle);
+        if (ret != MM_SUCCESS) {
+            LOG_F(ERROR, "[InferenceEngine] Create detector %s on %s:%d failed! Code: %d",
+                model_path.c_str(), device_name.c_str(), device_id, (int)ret);
+            handle = nullptr;
+            state = -1;
+            return;
+        }
+        worker = std::thread(&InferenceEngine::run, this);
+        LOG_F(INFO, "[InferenceEngine] Create detector %s on %s:%d, max batch size: %d, max wait: %ldus",
+            model_path.c_str(), device_name.c_str(), device_id, this->max_batch_size, this->max_wait_microsecond);
+    }
+
+    InferenceEngine::~InferenceEngine() {
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            stopping = true;
+        }
+        cond.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+        if (handle != nullptr) {
+            mmdeploy_detector_destroy(handle);
+        }
+        LOG_F(INFO, "[InferenceEngine] Release detector, batches: %lu, images: %lu",
+            (unsigned long)num_batches, (unsigned long)num_images);
+    }
+
+    int InferenceEngine::infer(const cv::Mat & img, std::vector<Object> & objects, float score_thre) {
+        if (state == -1) {
+            return -1;
+        }
+        inference_request_t request;
+        request.img = &img;
+        request.objects = &objects;
+        request.score_thre = score_thre;
+        request.submit_time = std::chrono::steady_clock::now();
+        std::future<int> result = request.result.get_future();
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            if (stopping) {
+                return -1;
+            }
+            requests.emplace_back(&request);
+        }
+        cond.notify_one();
+        return result.get();
+    }
+
+    int InferenceEngine::warm_up(const int width, const int height, const int num_runs) {
+        const cv::Mat img = cv::Mat::zeros(std::max(height, 1), std::max(width, 1), CV_8UC3);
+        std::vector<Object> objects;
+        auto start_time = std::chrono::steady_clock::now();
+        for (int i = 0; i < num_runs; i++) {
+            if (i == num_runs - 1) {
+                // the first runs pay for the lazy initialization, keep them out of the cost
+                cost_microsecond = 0;
+            }
+            objects.clear();
+            if (infer(img, objects, 1.0f) == -1) {
+                return -1;
+            }
+        }
+        LOG_F(INFO, "[InferenceEngine] Warm up %d runs on %dx%d in %ldms, cost: %ldus per image", num_runs, width, height,
+            (long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count(),
+            (long)cost_microsecond);
+        return 0;
+    }
+
+    void InferenceEngine::run() {
+        std::vector<inference_request_t *> batch;
+        batch.reserve(max_batch_size);
+        for (;;) {
+            batch.clear();
+            {
+                std::unique_lock<std::mutex> unique_lock(lock);
+                cond.wait(unique_lock, [this]() { return stopping || !requests.empty(); });
+                if (requests.empty()) {
+                    break;
+                }
+                auto deadline = requests.front()->submit_time + std::chrono::microseconds(max_wait_microsecond);
+                while ((int)requests.size() < max_batch_size && !stopping) {
+                    if (cond.wait_until(unique_lock, deadline) == std::cv_status::timeout) {
+                        break;
+                    }
+                }
+                while (!requests.empty() && (int)batch.size() < max_batch_size) {
+                    batch.emplace_back(requests.front());
+                    requests.pop_front();
+                }
+            }
+            apply(batch);
+        }
+    }
+
+    void InferenceEngine::apply(std::vector<inference_request_t *> & batch) {
+        int ret;
+        const int num_mats = batch.size();
+        std::vector<mm_mat_t> mats;
+        mats.reserve(num_mats);
+        for (auto request : batch) {
+            const cv::Mat & img = *request->img;
+            mats.push_back(mm_mat_t{img.data, img.rows, img.cols, 3, MM_BGR, MM_INT8});
+        }
+        mm_detect_t * bboxes;
+        int * res_count;
+        auto apply_time = std::chrono::steady_clock::now();
+        ret = mmdeploy_detector_apply(handle, mats.data(), num_mats, &bboxes, &res_count);
+        if (ret != MM_SUCCESS) {
+            LOG_F(ERROR, "[InferenceEngine] Apply detector failed! Code: %d", (int)ret);
+            for (auto request : batch) {
+                request->result.set_value(-1);
+            }
+            return;
+        }
+        // a failed apply returns early, it must not look cheap to the scheduler
+        const long cost = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - apply_time).count() / num_mats;
+        cost_microsecond = cost_microsecond == 0 ? cost : (long)(0.9 * cost_microsecond + 0.1 * cost);
+        // results of the images are laid out one after another
+        int offset = 0;
+        for (int i = 0; i < num_mats; i++) {
+            inference_request_t * request = batch[i];
+            std::vector<Object> & objects = *request->objects;
+            for (int obj_id = offset; obj_id < offset + res_count[i]; obj_id++) {
+                const auto & score = bboxes[obj_id].score;
+                if (score < request->score_thre) {
+                    continue;
+                }
+                const auto & box = bboxes[obj_id].bbox;
+                if ((box.right - box.left) < 1 || (box.bottom - box.top) < 1) {
+                    continue;
+                }
+                const auto & label_id = bboxes[obj_id].label_id;
+                objects.emplace_back(
+                    (cv::Rect_<float>){
+                        box.left, box.top,
+                        box.right  - box.left,
+                        box.bottom - box.top,
+                    },
+                    label_id,
+                    score
+                );
+            }
+            offset += res_count[i];
+        }
+        mmdeploy_detector_release_result(bboxes, res_count, num_mats);
+        num_batches++;
+        num_images += num_mats;
+        for (auto request : batch) {
+            request->result.set_value(0);
+        }
+    }
+
+    std::shared_ptr<InferenceEngine> InferenceService::acquire(const std::string & model_path,
+                                                               const std::string & device_name,
+                                                               const int device_id) {
+        const std::string key = engine_key(model_path, device_name, device_id);
+        std::promise<std::shared_ptr<InferenceEngine>> loaded;
+        std::shared_future<std::shared_ptr<InferenceEngine>> loading;
+        // the last reference may be dropped by a room meanwhile, the engine has to be destroyed out of the lock
+        std::shared_ptr<InferenceEngine> engine;
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            auto iter = engines.find(key);
+            engine = iter == engines.end() ? nullptr : iter->second.lock();
+            if (engine == nullptr) {
+                auto loading_iter = loadings.find(key);
+                if (loading_iter != loadings.end()) {
+                    loading = loading_iter->second;
+                } else {
+                    loadings[key] = loaded.get_future().share();
+                }
+            }
+        }
+        if (engine != nullptr) {
+            return engine;
+        }
+        if (loading.valid()) {
+            // another room is loading the model, wait for it instead of loading it twice
+            return loading.get();
+        }
+
+        // the model is loaded out of the lock, it takes seconds and the costs are read meanwhile
+        engine = std::make_shared<InferenceEngine>(model_path, device_name, device_id,
+            constants::max_inference_batch_size, constants::max_inference_wait_microsecond);
+        if (engine->state == -1) {
+            engine = nullptr;
+        }
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            loadings.erase(key);
+            if (engine != nullptr) {
+                engines[key] = engine;
+            } else {
+                engines.erase(key);
+            }
+        }
+        loaded.set_value(engine);
+        return engine;
+    }
+
+    std::string InferenceService::engine_key(const std::string & model_path,
+                                             const std::string & device_name,
+                                             const int device_id) {
+        return model_path + "|" + device_name + "|" + std::to_string(device_id);
+    }
+
+    int InferenceService::preload(const std::string & model_path,
+                                  const std::string & device_name,
+                                  const int device_id,
+                                  const int warmup_width,
+                                  const int warmup_height,
+                                  const int num_warmups) {
+        auto start_time = std::chrono::steady_clock::now();
+        std::shared_ptr<InferenceEngine> engine = acquire(model_path, device_name, device_id);
+        if (engine == nullptr) {
+            LOG_F(ERROR, "[InferenceService] Preload %s on %s:%d fail!", model_path.c_str(), device_name.c_str(), device_id);
+            return -1;
+        }
+        if (num_warmups > 0 && engine->warm_up(warmup_width, warmup_height, num_warmups) == -1) {
+            LOG_F(ERROR, "[InferenceService] Warm up %s on %s:%d fail!", model_path.c_str(), device_name.c_str(), device_id);
+            return -1;
+        }
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            preloaded[engine_key(model_path, device_name, device_id)] = engine;
+        }
+        LOG_F(INFO, "[InferenceService] Preload %s on %s:%d in %ldms", model_path.c_str(), device_name.c_str(), device_id,
+            (long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count());
+        return 0;
+    }
+
+    void InferenceService::release() {
+        std::unordered_map<std::string, std::shared_ptr<InferenceEngine>> released;
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            released.swap(preloaded);
+        }
+        // the engines not held by a room are destroyed here, out of the lock
+        released.clear();
+    }
+
+    long InferenceService::get_cost_microsecond() {
+        long cost = 0;
+        std::vector<std::shared_ptr<InferenceEngine>> alive;
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            for (auto & iter : engines) {
+                std::shared_ptr<InferenceEngine> engine = iter.second.lock();
+                if (engine != nullptr) {
+                    alive.emplace_back(std::move(engine));
+                }
+            }
+        }
+        // the engines whose rooms left meanwhile are destroyed here, out of the lock
+        for (auto & engine : alive) {
+            cost = std::max(cost, engine->get_cost_microsecond());
+        }
+        return cost;
+    }
+}
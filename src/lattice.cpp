@@ -0,0 +1,153 @@
+#include "lattice.h"
+
+namespace GLCC {
+    void zone_state::remap(const std::vector<int> & previous_ids) {
+        zone_state previous = std::move(*this);
+        const int num_zones = previous_ids.size();
+        is_in_contour.assign(num_zones, 0);
+        is_into_timing.assign(num_zones, 0);
+        is_out_timing.assign(num_zones, 0);
+        into_contour_time_point.resize(num_zones);
+        out_contour_time_point.resize(num_zones);
+        num_in_contour = 0;
+        for (int zone_id = 0; zone_id < num_zones; zone_id++) {
+            const int previous_id = previous_ids[zone_id];
+            if (previous_id < 0 || previous_id >= (int)previous.is_in_contour.size()) {
+                continue;
+            }
+            is_in_contour[zone_id] = previous.is_in_contour[previous_id];
+            is_into_timing[zone_id] = previous.is_into_timing[previous_id];
+            is_out_timing[zone_id] = previous.is_out_timing[previous_id];
+            into_contour_time_point[zone_id] = previous.into_contour_time_point[previous_id];
+            out_contour_time_point[zone_id] = previous.out_contour_time_point[previous_id];
+            num_in_contour += is_in_contour[zone_id];
+        }
+    }
+
+    bool LatticeCache::is_stale(const long version, const cv::Size & frame_size) const {
+        return this->version != version || this->frame_size != frame_size;
+    }
+
+    void LatticeCache::build(const contour_list_t & contour_list, const cv::Size & frame_size, const long version) {
+        this->version = version;
+        this->frame_size = frame_size;
+        std::unordered_map<std::string, int> previous_zone_ids;
+        previous_zone_ids.swap(zone_ids);
+        zones.clear();
+        previous_ids.clear();
+        zones.reserve(contour_list.size());
+        previous_ids.reserve(contour_list.size());
+        const cv::Rect frame_rect(cv::Point(0, 0), frame_size);
+        for (auto & item : contour_list) {
+            lattice_zone_t zone;
+            zone.name = item.first;
+            zone.contours.emplace_back(item.second);
+            if (item.second.size() > 0) {
+                zone.rect = cv::boundingRect(item.second) & frame_rect;
+            }
+            if (zone.rect.area() > 0) {
+                zone.mask = cv::Mat::zeros(zone.rect.size(), CV_8UC1);
+                cv::fillPoly(zone.mask, zone.contours, cv::Scalar(255), 8, 0, -zone.rect.tl());
+                zone.blend.create(zone.rect.size(), CV_8UC3);
+            }
+            auto iter = previous_zone_ids.find(zone.name);
+            previous_ids.emplace_back(iter == previous_zone_ids.end() ? -1 : iter->second);
+            zone_ids[zone.name] = zones.size();
+            zones.emplace_back(std::move(zone));
+        }
+        build_index();
+        LOG_F(INFO, "[LatticeCache] Build %d zones for %dx%d frames, version: %ld",
+            (int)zones.size(), frame_size.width, frame_size.height, version);
+    }
+
+    void LatticeCache::build_index() {
+        grid_cols = (frame_size.width + cell_size - 1) / cell_size;
+        grid_rows = (frame_size.height + cell_size - 1) / cell_size;
+        num_words = (zones.size() + 63) / 64;
+        inside_bits.assign(grid_cols * grid_rows * num_words, 0);
+        boundary_bits.assign(grid_cols * grid_rows * num_words, 0);
+        occupied.assign(num_words, 0);
+        for (int zone_id = 0; zone_id < (int)zones.size(); zone_id++) {
+            const lattice_zone_t & zone = zones[zone_id];
+            if (zone.rect.area() <= 0) {
+                continue;
+            }
+            const int word = zone_id >> 6;
+            const uint64_t bit = (uint64_t)1 << (zone_id & 63);
+            const int col_begin = std::max(zone.rect.x - 1, 0) / cell_size;
+            const int col_end = std::min((zone.rect.x + zone.rect.width) / cell_size, grid_cols - 1);
+            const int row_begin = std::max(zone.rect.y - 1, 0) / cell_size;
+            const int row_end = std::min((zone.rect.y + zone.rect.height) / cell_size, grid_rows - 1);
+            for (int row = row_begin; row <= row_end; row++) {
+                for (int col = col_begin; col <= col_end; col++) {
+                    // the cell grown by one pixel, in the coordinates of the mask
+                    cv::Rect cell(col * cell_size - 1, row * cell_size - 1, cell_size + 2, cell_size + 2);
+                    cv::Rect cell_in_frame = cell & cv::Rect(cv::Point(0, 0), frame_size);
+                    cv::Rect cell_in_zone = cell_in_frame & zone.rect;
+                    if (cell_in_zone.area() <= 0) {
+                        continue;
+                    }
+                    int num_inside = cv::countNonZero(zone.mask(cell_in_zone - zone.rect.tl()));
+                    int index = (row * grid_cols + col) * num_words + word;
+                    if (num_inside == cell_in_frame.area()) {
+                        inside_bits[index] |= bit;
+                    } else if (num_inside > 0) {
+                        boundary_bits[index] |= bit;
+                    }
+                }
+            }
+        }
+    }
+
+    bool LatticeCache::contains(const int zone_id, const cv::Point & center) const {
+        return cv::pointPolygonTest(zones[zone_id].contours[0], center, false) >= 0;
+    }
+
+    void LatticeCache::locate(const std::vector<cv::Point> & centers) {
+        std::fill(occupied.begin(), occupied.end(), 0);
+        for (auto & center : centers) {
+            if (center.x < 0 || center.y < 0 || center.x >= frame_size.width || center.y >= frame_size.height) {
+                // off the frame, the zones may still reach there
+                for (int zone_id = 0; zone_id < (int)zones.size(); zone_id++) {
+                    if (!is_occupied(zone_id) && contains(zone_id, center)) {
+                        occupied[zone_id >> 6] |= (uint64_t)1 << (zone_id & 63);
+                    }
+                }
+                continue;
+            }
+            const int cell = (center.y / cell_size) * grid_cols + center.x / cell_size;
+            for (int word = 0; word < num_words; word++) {
+                const int index = cell * num_words + word;
+                occupied[word] |= inside_bits[index];
+                uint64_t pending = boundary_bits[index] & ~occupied[word];
+                while (pending) {
+                    const int bit = __builtin_ctzll(pending);
+                    pending &= pending - 1;
+                    if (contains(word * 64 + bit, center)) {
+                        occupied[word] |= (uint64_t)1 << bit;
+                    }
+                }
+            }
+        }
+    }
+
+    void LatticeCache::fill(cv::Mat & frame, const int zone_id, const cv::Scalar & color, const double alpha) {
+        lattice_zone_t & zone = zones[zone_id];
+        if (zone.rect.area() <= 0) {
+            return;
+        }
+        // both are vectorized by opencv and bounded by the rect
+        cv::Mat roi = frame(zone.rect);
+        roi.convertTo(zone.blend, -1, 1 - alpha);
+        cv::add(zone.blend, color * alpha, roi, zone.mask);
+    }
+
+    void LatticeCache::outline(cv::Mat & frame, const int zone_id, const cv::Scalar & color, const int thickness) const {
+        cv::polylines(frame, zones[zone_id].contours, true, color, thickness);
+    }
+
+    int LatticeCache::find(const std::string & name) const {
+        auto iter = zone_ids.find(name);
+        return iter == zone_ids.end() ? -1 : iter->second;
+    }
+}
@@ -0,0 +1,44 @@
+#include "lifecycle.h"
+
+namespace GLCC {
+    bool Lifecycle::transit(const int from, const int to) {
+        int expected = from;
+        if (!state.compare_exchange_strong(expected, to, std::memory_order_acq_rel)) {
+            return false;
+        }
+        {
+            // the waiters check the state under the lock, so they can't miss this notify
+            std::lock_guard<std::mutex> lock_guard(lock);
+        }
+        cond.notify_all();
+        return true;
+    }
+
+    bool Lifecycle::start() {
+        return transit(LIFECYCLE_STARTING, LIFECYCLE_RUNNING);
+    }
+
+    bool Lifecycle::cancel() {
+        return transit(LIFECYCLE_STARTING, LIFECYCLE_DRAINING) || transit(LIFECYCLE_RUNNING, LIFECYCLE_DRAINING);
+    }
+
+    void Lifecycle::finish() {
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            state.store(LIFECYCLE_STOPPED, std::memory_order_release);
+        }
+        cond.notify_all();
+    }
+
+    bool Lifecycle::wait_cancel(const long timeout_millisecond) {
+        std::unique_lock<std::mutex> unique_lock(lock);
+        return cond.wait_for(unique_lock, std::chrono::milliseconds(timeout_millisecond),
+                             [this]() { return is_cancelled(); });
+    }
+
+    bool Lifecycle::join(const long timeout_millisecond) {
+        std::unique_lock<std::mutex> unique_lock(lock);
+        return cond.wait_for(unique_lock, std::chrono::milliseconds(timeout_millisecond),
+                             [this]() { return get_state() == LIFECYCLE_STOPPED; });
+    }
+}
@@ -54,15 +54,97 @@ int main(int argc, char ** argv)
     const int db_server_port = db_root["db_server_port"].asInt();
     GLCC::constants::mysql_root_url = "mysql://" + user_name + ":" \
         + user_password + "@" + db_server_ip + ":" + std::to_string(db_server_port);
+    GLCC::constants::mysql_glccserver_url = GLCC::constants::mysql_root_url + "/glccserver";
+    GLCC::StatementCache::Instance().init(GLCC::constants::mysql_glccserver_url);
+
+    Json::Value write_behind_root = config_root["WriteBehind"];
+    GLCC::constants::write_behind_flush_millisecond = write_behind_root.get("flush_millisecond", 
+        (Json::Int64)GLCC::constants::write_behind_flush_millisecond).asInt64();
+    GLCC::constants::write_behind_max_batch_rows = write_behind_root.get("max_batch_rows", 
+        (Json::UInt64)GLCC::constants::write_behind_max_batch_rows).asUInt64();
+    GLCC::WriteBehind::Instance().init(GLCC::constants::write_behind_flush_millisecond, 
+        GLCC::constants::write_behind_max_batch_rows);
 
     Json::Value timer_root = config_root["Timer"];
-    GLCC::constants::interval_to_watch_detector_second = timer_root["interval_to_watch_detector_second"].asInt() \
-        * GLCC::constants::num_second_per_minute;
-    GLCC::constants::interval_to_watch_file_second = timer_root["interval_to_watch_file_second"].asInt() \
-        * GLCC::constants::num_second_per_minute;
+    GLCC::constants::expiry_load_window_second = timer_root.get("load_window_second", 
+        (Json::Int64)GLCC::constants::expiry_load_window_second).asInt64();
+    GLCC::constants::expiry_max_delete_rows = timer_root.get("max_delete_rows", 
+        (Json::UInt64)GLCC::constants::expiry_max_delete_rows).asUInt64();
     GLCC::constants::max_detector_live_day = timer_root["max_detector_live_day"].asInt();
     GLCC::constants::max_video_file_save_day = timer_root["max_video_file_save_day"].asInt();
 
+    Json::Value inference_root = config_root["Inference"];
+    GLCC::constants::max_inference_batch_size = inference_root.get("max_batch_size", 
+        GLCC::constants::max_inference_batch_size).asInt();
+    GLCC::constants::max_inference_wait_microsecond = inference_root.get("max_wait_microsecond", 
+        (Json::Int64)GLCC::constants::max_inference_wait_microsecond).asInt64();
+    GLCC::constants::inference_preload = inference_root.get("preload", 
+        GLCC::constants::inference_preload).asBool();
+    GLCC::constants::inference_warmup_width = inference_root.get("warmup_width", 
+        GLCC::constants::inference_warmup_width).asInt();
+    GLCC::constants::inference_warmup_height = inference_root.get("warmup_height", 
+        GLCC::constants::inference_warmup_height).asInt();
+    GLCC::constants::inference_num_warmups = inference_root.get("num_warmups", 
+        GLCC::constants::inference_num_warmups).asInt();
+
+    Json::Value thumbnail_root = config_root["Thumbnail"];
+    GLCC::constants::thumbnail_num_workers = thumbnail_root.get("num_workers", 
+        GLCC::constants::thumbnail_num_workers).asInt();
+    GLCC::constants::thumbnail_queue_size = thumbnail_root.get("queue_size", 
+        (Json::Int64)GLCC::constants::thumbnail_queue_size).asInt64();
+    GLCC::constants::thumbnail_policy = thumbnail_root.get("policy", "placeholder").asString() == "wait" ? \
+        GLCC::WAIT_POLICY : GLCC::PLACEHOLDER_POLICY;
+    GLCC::constants::thumbnail_wait_millisecond = thumbnail_root.get("wait_millisecond", 
+        (Json::Int64)GLCC::constants::thumbnail_wait_millisecond).asInt64();
+    GLCC::ThumbnailService::Instance().init(GLCC::constants::thumbnail_num_workers, 
+        GLCC::constants::thumbnail_queue_size);
+
+    Json::Value transmiss_root = config_root["Transmiss"];
+    GLCC::constants::transmiss_chunk_size = transmiss_root.get("chunk_size_kb", 
+        (Json::UInt64)(GLCC::constants::transmiss_chunk_size >> 10)).asUInt64() << 10;
+    GLCC::constants::transmiss_num_chunks = transmiss_root.get("num_chunks", 
+        (Json::UInt64)GLCC::constants::transmiss_num_chunks).asUInt64();
+    GLCC::constants::transmiss_max_range_chunks = transmiss_root.get("max_range_chunks", 
+        (Json::UInt64)GLCC::constants::transmiss_max_range_chunks).asUInt64();
+
+    Json::Value session_root = config_root["Session"];
+    GLCC::constants::session_num_shards = session_root.get("num_shards", 
+        GLCC::constants::session_num_shards).asInt();
+    GLCC::constants::session_max_sessions = session_root.get("max_sessions", 
+        (Json::Int64)GLCC::constants::session_max_sessions).asInt64();
+    GLCC::constants::session_ttl_second = session_root.get("ttl_second", 
+        (Json::Int64)GLCC::constants::session_ttl_second).asInt64();
+
+    Json::Value executor_root = config_root["Executor"];
+    GLCC::constants::executor_num_workers = executor_root.get("num_workers", 
+        GLCC::constants::executor_num_workers).asInt();
+    GLCC::constants::executor_pin_policy = GLCC::parse_pin_policy(executor_root.get("pin_policy", "none").asString());
+    for (int i = 0; i < (int)executor_root["cpus"].size(); i++) {
+        GLCC::constants::executor_cpus.emplace_back(executor_root["cpus"][i].asInt());
+    }
+    GLCC::DetectorExecutor::Instance().init(GLCC::constants::executor_num_workers, 
+        GLCC::constants::executor_pin_policy, GLCC::constants::executor_cpus);
+
+    Json::Value scheduler_root = config_root["Scheduler"];
+    GLCC::constants::scheduler_rooms_per_core = scheduler_root.get("rooms_per_core", 
+        GLCC::constants::scheduler_rooms_per_core).asDouble();
+    GLCC::constants::scheduler_max_utilization = scheduler_root.get("max_utilization", 
+        GLCC::constants::scheduler_max_utilization).asDouble();
+    GLCC::constants::scheduler_default_cost_microsecond = scheduler_root.get("default_cost_microsecond", 
+        (Json::Int64)GLCC::constants::scheduler_default_cost_microsecond).asInt64();
+    GLCC::constants::scheduler_min_fps = scheduler_root.get("min_fps", 
+        GLCC::constants::scheduler_min_fps).asInt();
+    GLCC::constants::scheduler_default_target_fps = scheduler_root.get("default_target_fps", 
+        GLCC::constants::scheduler_default_target_fps).asInt();
+    GLCC::constants::scheduler_queue_size = scheduler_root.get("queue_size", 
+        (Json::UInt64)GLCC::constants::scheduler_queue_size).asUInt64();
+    GLCC::constants::scheduler_rebalance_second = scheduler_root.get("rebalance_second", 
+        (Json::Int64)GLCC::constants::scheduler_rebalance_second).asInt64();
+    GLCC::RoomScheduler::Instance().init(GLCC::constants::scheduler_rooms_per_core, 
+        GLCC::constants::scheduler_max_utilization, GLCC::constants::scheduler_default_cost_microsecond, 
+        GLCC::constants::scheduler_min_fps, GLCC::constants::scheduler_queue_size, 
+        GLCC::constants::scheduler_rebalance_second);
+
     GLCC::GLCCServer server{config_path};
     if (server.server_state == -1) {
         LOG_F(INFO, "Init GLCCServer fail!");
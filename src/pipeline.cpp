@@ -0,0 +1,14 @@
+#include "pipeline.h"
+
+namespace GLCC {
+    int parse_drop_mode(const std::string & mode, const int default_mode) noexcept {
+        if (mode == "block") {
+            return BLOCK_DROP;
+        } else if (mode == "drop_newest") {
+            return NEWEST_DROP;
+        } else if (mode == "drop_oldest") {
+            return OLDEST_DROP;
+        }
+        return default_mode;
+    }
+}
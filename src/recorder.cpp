@@ -0,0 +1,254 @@
+#include "recorder.h"
+
+namespace GLCC {
+    static std::string av_error_string(const int errnum) {
+        char buf[AV_ERROR_MAX_STRING_SIZE] = {0};
+        av_strerror(errnum, buf, sizeof(buf));
+        return buf;
+    }
+
+    ClipRecorder::ClipRecorder(const int pre_event_second, const size_t queue_size):
+        pre_event_second(pre_event_second > 0 ? pre_event_second : 0),
+        queue_size(queue_size > 0 ? queue_size : 1) {}
+
+    ClipRecorder::~ClipRecorder() {
+        close();
+    }
+
+    int ClipRecorder::open(const AVCodecParameters * codecpar,
+                           const AVRational time_base,
+                           std::function<void(const std::string &)> open_func,
+                           std::function<void(const std::string &, const cv::Mat &)> close_func) {
+        if (worker.joinable()) {
+            return -1;
+        }
+        this->codecpar = avcodec_parameters_alloc();
+        if (this->codecpar == nullptr || avcodec_parameters_copy(this->codecpar, codecpar) < 0) {
+            LOG_F(ERROR, "[ClipRecorder] Copy codec parameters failed");
+            avcodec_parameters_free(&this->codecpar);
+            return -1;
+        }
+        // the tag is the one of the muxer the parameters come from (7 for H.264 in flv),
+        // let the mp4 muxer pick its own
+        this->codecpar->codec_tag = 0;
+        this->time_base = time_base;
+        this->open_func = open_func;
+        this->close_func = close_func;
+        clip_packet = av_packet_alloc();
+        stopping = false;
+        worker = std::thread(&ClipRecorder::run, this);
+        return 0;
+    }
+
+    void ClipRecorder::close() {
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            stopping = true;
+        }
+        cond.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+        for (auto & item : queue) {
+            av_packet_free(&item.packet);
+        }
+        queue.clear();
+        for (auto & packet : ring) {
+            av_packet_free(&packet);
+        }
+        ring.clear();
+        if (clip_packet != nullptr) {
+            av_packet_free(&clip_packet);
+        }
+        if (codecpar != nullptr) {
+            avcodec_parameters_free(&codecpar);
+        }
+    }
+
+    void ClipRecorder::push(const AVPacket * packet) {
+        const bool is_key = packet->flags & AV_PKT_FLAG_KEY;
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            if (stopping || !worker.joinable()) {
+                return;
+            }
+            // a dropped packet breaks the gop, skip to the next keyframe
+            if (queue.size() >= queue_size || (wait_keyframe && !is_key)) {
+                wait_keyframe = true;
+                num_dropped++;
+                return;
+            }
+            wait_keyframe = false;
+        }
+        clip_item_t item;
+        item.type = CLIP_PACKET;
+        item.packet = av_packet_clone(packet);
+        if (item.packet == nullptr) {
+            return;
+        }
+        enqueue(std::move(item));
+    }
+
+    void ClipRecorder::start(const std::string & path) {
+        clip_item_t item;
+        item.type = CLIP_START;
+        item.path = path;
+        enqueue(std::move(item));
+    }
+
+    void ClipRecorder::stop() {
+        clip_item_t item;
+        item.type = CLIP_STOP;
+        enqueue(std::move(item));
+    }
+
+    void ClipRecorder::set_cover(cv::Mat && cover) {
+        clip_item_t item;
+        item.type = CLIP_COVER;
+        item.cover = std::move(cover);
+        enqueue(std::move(item));
+    }
+
+    void ClipRecorder::enqueue(clip_item_t && item) {
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            if (stopping) {
+                av_packet_free(&item.packet);
+                return;
+            }
+            queue.emplace_back(std::move(item));
+        }
+        cond.notify_one();
+    }
+
+    void ClipRecorder::run() {
+        for (;;) {
+            clip_item_t item;
+            {
+                std::unique_lock<std::mutex> unique_lock(lock);
+                cond.wait(unique_lock, [this]() { return stopping || !queue.empty(); });
+                if (queue.empty()) {
+                    break;
+                }
+                item = std::move(queue.front());
+                queue.pop_front();
+            }
+            if (item.type == CLIP_PACKET) {
+                put_ring(item.packet);
+            } else if (item.type == CLIP_START) {
+                close_clip();
+                open_clip(item.path);
+            } else if (item.type == CLIP_STOP) {
+                close_clip();
+            } else if (item.type == CLIP_COVER) {
+                clip_cover = std::move(item.cover);
+            }
+        }
+        close_clip();
+    }
+
+    void ClipRecorder::put_ring(AVPacket * packet) {
+        if (ring.empty() && !(packet->flags & AV_PKT_FLAG_KEY)) {
+            // the ring always starts with a keyframe
+            av_packet_free(&packet);
+            return;
+        }
+        ring.emplace_back(packet);
+        if (clip_context != nullptr) {
+            write_clip(packet);
+        }
+        // drop the leading gops as long as the next one still covers pre_event_second
+        const int64_t pre_event_pts = av_rescale_q(pre_event_second, AVRational{1, 1}, time_base);
+        for (;;) {
+            auto next_key = std::find_if(ring.begin() + 1, ring.end(),
+                [](const AVPacket * item) { return item->flags & AV_PKT_FLAG_KEY; });
+            if (next_key == ring.end() || (*next_key)->pts > packet->pts - pre_event_pts) {
+                break;
+            }
+            for (auto iter = ring.begin(); iter != next_key; iter++) {
+                av_packet_free(&*iter);
+            }
+            ring.erase(ring.begin(), next_key);
+        }
+    }
+
+    int ClipRecorder::open_clip(const std::string & path) {
+        int ret = avformat_alloc_output_context2(&clip_context, nullptr, "mp4", path.c_str());
+        if (ret < 0 || clip_context == nullptr) {
+            LOG_F(ERROR, "[ClipRecorder] Alloc output context for %s failed: %s", path.c_str(), av_error_string(ret).c_str());
+            clip_context = nullptr;
+            return -1;
+        }
+        clip_stream = avformat_new_stream(clip_context, nullptr);
+        if (clip_stream == nullptr || avcodec_parameters_copy(clip_stream->codecpar, codecpar) < 0) {
+            LOG_F(ERROR, "[ClipRecorder] Create stream for %s failed", path.c_str());
+            avformat_free_context(clip_context);
+            clip_context = nullptr;
+            return -1;
+        }
+        clip_stream->time_base = time_base;
+        ret = avio_open(&clip_context->pb, path.c_str(), AVIO_FLAG_WRITE);
+        if (ret < 0) {
+            LOG_F(ERROR, "[ClipRecorder] Open %s failed: %s", path.c_str(), av_error_string(ret).c_str());
+            avformat_free_context(clip_context);
+            clip_context = nullptr;
+            return -1;
+        }
+        ret = avformat_write_header(clip_context, nullptr);
+        if (ret < 0) {
+            LOG_F(ERROR, "[ClipRecorder] Write header to %s failed: %s", path.c_str(), av_error_string(ret).c_str());
+            avio_closep(&clip_context->pb);
+            avformat_free_context(clip_context);
+            clip_context = nullptr;
+            return -1;
+        }
+        clip_path = path;
+        clip_cover.release();
+        clip_start_pts = ring.empty() ? AV_NOPTS_VALUE : ring.front()->pts;
+        for (auto packet : ring) {
+            write_clip(packet);
+        }
+        LOG_F(INFO, "[ClipRecorder] Start %s with %d lead-in packets", path.c_str(), (int)ring.size());
+        if (open_func != nullptr) {
+            open_func(clip_path);
+        }
+        return 0;
+    }
+
+    int ClipRecorder::write_clip(const AVPacket * packet) {
+        if (clip_start_pts == AV_NOPTS_VALUE) {
+            clip_start_pts = packet->pts;
+        }
+        int ret = av_packet_ref(clip_packet, packet);
+        if (ret < 0) {
+            return -1;
+        }
+        clip_packet->pts -= clip_start_pts;
+        clip_packet->dts -= clip_start_pts;
+        clip_packet->stream_index = clip_stream->index;
+        av_packet_rescale_ts(clip_packet, time_base, clip_stream->time_base);
+        ret = av_write_frame(clip_context, clip_packet);
+        av_packet_unref(clip_packet);
+        if (ret < 0) {
+            LOG_F(ERROR, "[ClipRecorder] Write packet to %s failed: %s", clip_path.c_str(), av_error_string(ret).c_str());
+            return -1;
+        }
+        return 0;
+    }
+
+    void ClipRecorder::close_clip() {
+        if (clip_context == nullptr) {
+            return;
+        }
+        av_write_trailer(clip_context);
+        avio_closep(&clip_context->pb);
+        avformat_free_context(clip_context);
+        clip_context = nullptr;
+        clip_stream = nullptr;
+        LOG_F(INFO, "[ClipRecorder] Close %s", clip_path.c_str());
+        if (close_func != nullptr) {
+            close_func(clip_path, clip_cover);
+        }
+        clip_cover.release();
+    }
+}
@@ -0,0 +1,70 @@
+#include "router.h"
+
+namespace GLCC {
+    static std::string upper_method(const std::string & method) noexcept {
+        std::string upper = method;
+        std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+        return upper;
+    }
+
+    int Router::add(const std::string & method, const std::string & path, route_func_t func) {
+        auto & path_routes = routes[upper_method(method)];
+        if (path_routes.count(path)) {
+            LOG_F(ERROR, "[Router] Route %s %s exists!", method.c_str(), path.c_str());
+            return -1;
+        }
+        path_routes.emplace(path, std::move(func));
+        return 0;
+    }
+
+    int Router::add_prefix(const std::string & method, const std::string & prefix, route_func_t func) {
+        auto & method_routes = prefix_routes[upper_method(method)];
+        for (auto & route : method_routes) {
+            if (route.prefix == prefix) {
+                LOG_F(ERROR, "[Router] Prefix route %s %s exists!", method.c_str(), prefix.c_str());
+                return -1;
+            }
+        }
+        method_routes.push_back(prefix_route_t{prefix, std::move(func)});
+        std::stable_sort(method_routes.begin(), method_routes.end(),
+            [](const prefix_route_t & a, const prefix_route_t & b) { return a.prefix.size() > b.prefix.size(); });
+        return 0;
+    }
+
+    const route_func_t * Router::find(const std::string & method, const std::string & uri) const {
+        const size_t path_size = std::min(uri.find('?'), uri.size());
+        const std::string path = uri.substr(0, path_size);
+        auto method_iter = routes.find(method);
+        if (method_iter == routes.end()) {
+            method_iter = routes.find(upper_method(method));
+        }
+        if (method_iter != routes.end()) {
+            auto path_iter = method_iter->second.find(path);
+            if (path_iter != method_iter->second.end()) {
+                return &path_iter->second;
+            }
+        }
+        auto prefix_iter = prefix_routes.find(method);
+        if (prefix_iter == prefix_routes.end()) {
+            prefix_iter = prefix_routes.find(upper_method(method));
+        }
+        if (prefix_iter != prefix_routes.end()) {
+            for (auto & route : prefix_iter->second) {
+                if (path.compare(0, route.prefix.size(), route.prefix) == 0) {
+                    return &route.func;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    bool Router::dispatch(WFHttpTask * task, void * context) const {
+        protocol::HttpRequest * req = task->get_req();
+        const route_func_t * func = find(req->get_method(), req->get_request_uri());
+        if (func == nullptr) {
+            return false;
+        }
+        (*func)(task, context);
+        return true;
+    }
+}
@@ -0,0 +1,99 @@
+#include "row_mapper.h"
+
+namespace GLCC {
+    // numbers come as text, copy them into a small buffer to terminate them
+    static int copy_number(const protocol::MySQLCell & cell, char * buffer, const size_t buffer_size) noexcept {
+        const void * data; size_t len; int data_type;
+        cell.get_cell_nocopy(&data, &len, &data_type);
+        if (cell.is_null() || len == 0 || len >= buffer_size) {
+            return -1;
+        }
+        memcpy(buffer, data, len);
+        buffer[len] = '\0';
+        return 0;
+    }
+
+    int decode_cell(const protocol::MySQLCell & cell, std::string & value) noexcept {
+        if (cell.is_null()) {
+            return -1;
+        }
+        const void * data; size_t len; int data_type;
+        cell.get_cell_nocopy(&data, &len, &data_type);
+        value.assign((const char *)data, len);
+        return 0;
+    }
+
+    int decode_cell(const protocol::MySQLCell & cell, long long & value) noexcept {
+        char buffer[32]; char * end;
+        if (copy_number(cell, buffer, sizeof(buffer)) == -1) {
+            return -1;
+        }
+        long long result = std::strtoll(buffer, &end, 10);
+        if (*end != '\0') {
+            return -1;
+        }
+        value = result;
+        return 0;
+    }
+
+    int decode_cell(const protocol::MySQLCell & cell, int & value) noexcept {
+        long long result;
+        if (decode_cell(cell, result) == -1) {
+            return -1;
+        }
+        value = (int)result;
+        return 0;
+    }
+
+    int decode_cell(const protocol::MySQLCell & cell, double & value) noexcept {
+        char buffer[64]; char * end;
+        if (copy_number(cell, buffer, sizeof(buffer)) == -1) {
+            return -1;
+        }
+        double result = std::strtod(buffer, &end);
+        if (*end != '\0') {
+            return -1;
+        }
+        value = result;
+        return 0;
+    }
+
+    void dump_mysql_fields(const protocol::MySQLResultCursor & cursor) {
+        const protocol::MySQLField * const * fields = cursor.fetch_fields();
+        LOG_F(1, "---------------- RESULT SET ----------------");
+        LOG_F(1, "cursor_status=%d field_count=%u rows_count=%u",
+            cursor.get_cursor_status(), cursor.get_field_count(), cursor.get_rows_count());
+        for (int i = 0; i < cursor.get_field_count(); i++) {
+            if (i == 0) {
+                LOG_F(1, "db=%s table=%s", fields[i]->get_db().c_str(), fields[i]->get_table().c_str());
+            }
+            LOG_F(1, "  name[%s] type[%s]", fields[i]->get_name().c_str(), datatype2str(fields[i]->get_data_type()));
+        }
+    }
+
+    void dump_mysql_row(const protocol::MySQLField * const * fields, const std::vector<protocol::MySQLCell> & row) {
+        std::stringstream row_infos;
+        for (size_t i = 0; i < row.size(); i++) {
+            row_infos << " [" << fields[i]->get_name() << "][" << datatype2str(row[i].get_data_type()) << "]";
+            if (row[i].is_null()) {
+                row_infos << "[NULL]";
+            } else {
+                // the text protocol keeps the digits of floats and doubles as they are stored
+                const void * data; size_t len; int data_type;
+                row[i].get_cell_nocopy(&data, &len, &data_type);
+                row_infos << "[" << std::string((const char *)data, len) << "]";
+            }
+        }
+        LOG_F(1, "  ROW:%s", row_infos.str().c_str());
+    }
+
+    void dump_mysql_status(const protocol::MySQLResponse * resp) {
+        if (resp->get_packet_type() == MYSQL_PACKET_ERROR) {
+            LOG_F(1, "ERROR. error_code=%d %s", resp->get_error_code(), resp->get_error_msg().c_str());
+        } else if (resp->get_packet_type() == MYSQL_PACKET_OK) {
+            LOG_F(1, "OK. %llu %s affected. %d warnings. insert_id=%llu. %s",
+                resp->get_affected_rows(), resp->get_affected_rows() == 1 ? "row" : "rows",
+                resp->get_warnings(), resp->get_last_insert_id(), resp->get_info().c_str());
+        }
+    }
+}
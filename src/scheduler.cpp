@@ -0,0 +1,236 @@
+#include "scheduler.h"
+#include "inference.h"
+#include "executor.h"
+
+namespace GLCC {
+    static bool is_prior(const std::shared_ptr<room_quota_t> & a, const std::shared_ptr<room_quota_t> & b) {
+        return a->priority != b->priority ? a->priority > b->priority : a->id < b->id;
+    }
+
+    int RoomScheduler::init(const double rooms_per_core, const double max_utilization, const long default_cost_microsecond,
+                            const int min_fps, const size_t queue_size, const long rebalance_second) {
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            this->rooms_per_core = std::max(rooms_per_core, 0.0);
+            this->max_utilization = max_utilization > 0 ? max_utilization : 0.8;
+            this->default_cost_microsecond = std::max(default_cost_microsecond, 1L);
+            this->min_fps = std::max(min_fps, 1);
+            this->queue_size = queue_size;
+            this->rebalance_second = std::max(rebalance_second, 1L);
+            stopping = false;
+            std::vector<std::shared_ptr<room_quota_t>> started;
+            rebalance(started);
+            LOG_F(INFO, "[Scheduler] Max rooms: %d, capacity: %d fps at %ldus per image, queue size: %lu",
+                max_rooms, capacity_fps, cost_microsecond, (unsigned long)queue_size);
+        }
+        schedule_rebalance();
+        return 0;
+    }
+
+    void RoomScheduler::release() {
+        std::lock_guard<std::mutex> lock_guard(lock);
+        stopping = true;
+        queue.clear();
+    }
+
+    bool RoomScheduler::fits(const room_quota_t & quota) const {
+        if ((int)rooms.size() >= max_rooms) {
+            return false;
+        }
+        int sum_min_fps = get_min_fps(quota);
+        for (auto & room : rooms) {
+            sum_min_fps += get_min_fps(*room);
+        }
+        return sum_min_fps <= capacity_fps;
+    }
+
+    void RoomScheduler::refresh_capacity() {
+        // the model warm-up measures the cost before the first room, the default only stands in until then
+        const long measured_cost = InferenceService::Instance().get_cost_microsecond();
+        cost_microsecond = measured_cost > 0 ? measured_cost : default_cost_microsecond;
+        capacity_fps = (int)(max_utilization * constants::num_microsecond_per_second / cost_microsecond);
+        // a room holds an executor worker until it stops, never admit more than there are workers
+        max_rooms = DetectorExecutor::Instance().get_num_workers();
+        if (rooms_per_core > 0) {
+            max_rooms = std::min(max_rooms, (int)(std::thread::hardware_concurrency() * rooms_per_core));
+        }
+        max_rooms = std::max(max_rooms, 1);
+    }
+
+    void RoomScheduler::rebalance(std::vector<std::shared_ptr<room_quota_t>> & started) {
+        refresh_capacity();
+
+        while (!stopping && !queue.empty() && fits(*queue.front())) {
+            std::shared_ptr<room_quota_t> quota = queue.front();
+            queue.pop_front();
+            quota->state = ROOM_ADMITTED;
+            rooms.emplace_back(quota);
+            started.emplace_back(quota);
+        }
+
+        // every room gets its floor, the rest goes by priority
+        std::sort(rooms.begin(), rooms.end(), is_prior);
+        int remaining_fps = capacity_fps;
+        for (auto & room : rooms) {
+            remaining_fps -= get_min_fps(*room);
+        }
+        for (auto & room : rooms) {
+            int extra_fps = std::max(std::min(get_target_fps(*room) - get_min_fps(*room), remaining_fps), 0);
+            remaining_fps -= extra_fps;
+            int assigned_fps = get_min_fps(*room) + extra_fps;
+            if (room->assigned_fps != assigned_fps) {
+                LOG_F(INFO, "[Scheduler][%s] Priority: %d, fps: %d -> %d", room->room_name.c_str(),
+                    room->priority, (int)room->assigned_fps, assigned_fps);
+                room->assigned_fps = assigned_fps;
+            }
+        }
+    }
+
+    int RoomScheduler::start(std::vector<std::shared_ptr<room_quota_t>> && started,
+                             const std::shared_ptr<room_quota_t> & admitted) {
+        int ret = 0;
+        for (auto & quota : started) {
+            room_start_t start_func = std::move(quota->start_func);
+            quota->start_func = nullptr;
+            LOG_F(INFO, "[Scheduler][%s] Admit with %d fps", quota->room_name.c_str(), (int)quota->assigned_fps);
+            if (start_func(quota) == -1) {
+                LOG_F(ERROR, "[Scheduler][%s] Start fail!", quota->room_name.c_str());
+                leave(quota);
+                if (quota == admitted) {
+                    ret = -1;
+                }
+            }
+        }
+        return ret;
+    }
+
+    int RoomScheduler::admit(const std::string & room_name, const int priority, const int target_fps, room_start_t start_func) {
+        std::shared_ptr<room_quota_t> quota = std::make_shared<room_quota_t>();
+        quota->room_name = room_name;
+        quota->priority = priority;
+        quota->target_fps = std::max(target_fps, 0);
+        quota->start_func = std::move(start_func);
+
+        int admission;
+        std::vector<std::shared_ptr<room_quota_t>> started;
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            if (stopping) {
+                return ROOM_REJECTED;
+            }
+            auto is_same_room = [&room_name](const std::shared_ptr<room_quota_t> & room) {
+                return room->room_name == room_name && !room->is_cancelled;
+            };
+            if (std::any_of(rooms.begin(), rooms.end(), is_same_room)) {
+                return ROOM_ADMITTED;
+            }
+            if (std::any_of(queue.begin(), queue.end(), is_same_room)) {
+                return ROOM_QUEUED;
+            }
+            quota->id = next_id++;
+            refresh_capacity();
+            auto iter = std::upper_bound(queue.begin(), queue.end(), quota, is_prior);
+            bool is_head = iter == queue.begin();
+            if (is_head && fits(*quota)) {
+                quota->state = ROOM_ADMITTED;
+                rooms.emplace_back(quota);
+                started.emplace_back(quota);
+                rebalance(started);
+                admission = ROOM_ADMITTED;
+            } else if (queue.size() < queue_size) {
+                queue.insert(iter, quota);
+                admission = ROOM_QUEUED;
+                LOG_F(INFO, "[Scheduler][%s] Queue at %d of %lu", room_name.c_str(),
+                    (int)(std::find(queue.begin(), queue.end(), quota) - queue.begin()), (unsigned long)queue.size());
+            } else {
+                num_rejected++;
+                admission = ROOM_REJECTED;
+                LOG_F(WARNING, "[Scheduler][%s] Reject, %d rooms running, %lu queued", room_name.c_str(),
+                    (int)rooms.size(), (unsigned long)queue.size());
+            }
+        }
+        if (start(std::move(started), quota) == -1) {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            num_rejected++;
+            return ROOM_REJECTED;
+        }
+        return admission;
+    }
+
+    void RoomScheduler::leave(const std::shared_ptr<room_quota_t> & quota) {
+        std::vector<std::shared_ptr<room_quota_t>> started;
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            auto iter = std::find(rooms.begin(), rooms.end(), quota);
+            if (iter == rooms.end()) {
+                return;
+            }
+            rooms.erase(iter);
+            LOG_F(INFO, "[Scheduler][%s] Leave, %d rooms running", quota->room_name.c_str(), (int)rooms.size());
+            rebalance(started);
+        }
+        start(std::move(started));
+    }
+
+    void RoomScheduler::cancel(const std::string & room_name) {
+        std::lock_guard<std::mutex> lock_guard(lock);
+        auto iter = std::remove_if(queue.begin(), queue.end(), [&room_name](const std::shared_ptr<room_quota_t> & room) {
+            return room->room_name == room_name;
+        });
+        if (iter != queue.end()) {
+            LOG_F(INFO, "[Scheduler][%s] Drop the queued room", room_name.c_str());
+            queue.erase(iter, queue.end());
+        }
+        for (auto & room : rooms) {
+            if (room->room_name == room_name) {
+                room->is_cancelled = true;
+            }
+        }
+    }
+
+    void RoomScheduler::schedule_rebalance() {
+        // the measured cost moves as the rooms warm up and the batches fill, follow it
+        WFTimerTask * timer_task = WFTaskFactory::create_timer_task(rebalance_second, 0, [this](WFTimerTask * task) {
+            std::vector<std::shared_ptr<room_quota_t>> started;
+            {
+                std::lock_guard<std::mutex> lock_guard(lock);
+                if (stopping) {
+                    return;
+                }
+                rebalance(started);
+            }
+            start(std::move(started));
+            schedule_rebalance();
+        });
+        timer_task->start();
+    }
+
+    Json::Value RoomScheduler::get_state() {
+        std::lock_guard<std::mutex> lock_guard(lock);
+        Json::Value state;
+        state["cores"] = std::thread::hardware_concurrency();
+        state["max_rooms"] = max_rooms;
+        state["cost_microsecond"] = (Json::Int64)cost_microsecond;
+        state["capacity_fps"] = capacity_fps;
+        state["num_rejected"] = (Json::UInt64)num_rejected;
+        int used_fps = 0;
+        for (auto & room : rooms) {
+            Json::Value item;
+            item["room_name"] = room->room_name;
+            item["priority"] = room->priority;
+            item["target_fps"] = room->target_fps;
+            item["assigned_fps"] = (int)room->assigned_fps;
+            used_fps += room->assigned_fps;
+            state["rooms"].append(item);
+        }
+        for (auto & room : queue) {
+            Json::Value item;
+            item["room_name"] = room->room_name;
+            item["priority"] = room->priority;
+            item["target_fps"] = room->target_fps;
+            state["queue"].append(item);
+        }
+        state["used_fps"] = used_fps;
+        return state;
+    }
+}
@@ -1,18 +1,90 @@
 #include "server.h"
 
-#define REGEX_FUNC(func, method, rex, task, ...) if \ 
-    (GLCC::GLCCServer::parse_request(task, method, rex)) { \
-    func(task, ## __VA_ARGS__) ; \
-}
-
-#define REGEX_VALUE(rex, task) std::regex_match(task->get_req()->get_request_uri(), std::regex(rex));
-
 namespace GLCC {
 
     WFFacilities::WaitGroup GLCCServer::server_wait_group(1);
     WFFacilities::WaitGroup GLCCServer::mysql_wait_group(1);
+    Router GLCCServer::main_router;
+    Router GLCCServer::login_router;
+
+    // how long a restart waits for the stopping detector of its room
+    static const long detector_join_millisecond = 5000;
+    // how often a listing under the wait policy checks its pending covers
+    static const long thumbnail_poll_millisecond = 20;
+
+    // the mappers are built once, their columns are resolved once per result set
+    static const RowMapper<user_row_t> & user_mapper() {
+        static const RowMapper<user_row_t> mapper = RowMapper<user_row_t>()
+            .bind("username", &user_row_t::username)
+            .bind("password", &user_row_t::password);
+        return mapper;
+    }
+
+    static const RowMapper<video_row_t> & video_mapper() {
+        static const RowMapper<video_row_t> mapper = RowMapper<video_row_t>()
+            .bind("video_name", &video_row_t::video_name)
+            .bind("video_url", &video_row_t::video_url);
+        return mapper;
+    }
+
+    static const RowMapper<contour_row_t> & contour_mapper() {
+        static const RowMapper<contour_row_t> mapper = RowMapper<contour_row_t>()
+            .bind("contour_name", &contour_row_t::contour_name)
+            .bind("contour_path", &contour_row_t::contour_path);
+        return mapper;
+    }
+
+    static const RowMapper<contour_row_t> & video_contour_mapper() {
+        static const RowMapper<contour_row_t> mapper = RowMapper<contour_row_t>()
+            .bind("contour_video_name", &contour_row_t::video_name)
+            .bind("contour_name", &contour_row_t::contour_name)
+            .bind("contour_path", &contour_row_t::contour_path);
+        return mapper;
+    }
+
+    static const RowMapper<file_row_t> & file_mapper() {
+        static const RowMapper<file_row_t> mapper = RowMapper<file_row_t>()
+            .bind("file_path", &file_row_t::file_path)
+            .bind("start_time", &file_row_t::start_time)
+            .bind("end_time", &file_row_t::end_time);
+        return mapper;
+    }
+
+    static const RowMapper<file_row_t> & video_file_mapper() {
+        static const RowMapper<file_row_t> mapper = RowMapper<file_row_t>()
+            .bind("video_name", &file_row_t::video_name)
+            .bind("file_path", &file_row_t::file_path)
+            .bind("start_time", &file_row_t::start_time)
+            .bind("end_time", &file_row_t::end_time);
+        return mapper;
+    }
+
+    static const RowMapper<room_row_t> & room_mapper() {
+        static const RowMapper<room_row_t> mapper = RowMapper<room_row_t>()
+            .bind("room_name", &room_row_t::room_name);
+        return mapper;
+    }
+
+    static const RowMapper<expiry_row_t> & file_expiry_mapper() {
+        static const RowMapper<expiry_row_t> mapper = RowMapper<expiry_row_t>()
+            .bind("username", &expiry_row_t::user_name)
+            .bind("video_name", &expiry_row_t::video_name)
+            .bind("file_path", &expiry_row_t::file_path)
+            .bind("end_second", &expiry_row_t::end_second);
+        return mapper;
+    }
+
+    static const RowMapper<expiry_row_t> & room_expiry_mapper() {
+        static const RowMapper<expiry_row_t> mapper = RowMapper<expiry_row_t>()
+            .bind("room_name", &expiry_row_t::room_name)
+            .bind("end_second", &expiry_row_t::end_second);
+        return mapper;
+    }
 
     GLCCServer::GLCCServer(const std::string config_path) {
+        init_router();
+        init_statements();
+        init_expiry();
         std::ifstream ifs;
         Json::Value root; 
         Json::Reader reader;
@@ -63,14 +135,10 @@ namespace GLCC {
         mysql_wait_group.wait(); 
 
         if (state == WFT_STATE_SUCCESS) {
-            WFTimerTask * file_timer_task = WFTaskFactory::create_timer_task(
-                constants::interval_to_watch_file_second, file_timer_callback
-            );
-            file_timer_task->start();
-            WFTimerTask * detector_timer_task = WFTaskFactory::create_timer_task(
-                constants::interval_to_watch_detector_second, detector_timer_callback
-            );
-            detector_timer_task->start();
+            if (constants::inference_preload) {
+                preload_models(glcc_server_context.detector_init_context);
+            }
+            ExpiryService::Instance().init(constants::expiry_load_window_second, constants::expiry_max_delete_rows);
 
             WFHttpServer server([&](WFHttpTask * task) {
                 main_callback(task, &glcc_server_context);
@@ -87,6 +155,14 @@ namespace GLCC {
             if (ret == 0) {
                 server_wait_group.wait();
                 server.stop();
+                for (auto & room_name : DetectorExecutor::Instance().get_running_rooms()) {
+                    cancel_detector(room_name, WAKE_CANCEL);
+                }
+                RoomScheduler::Instance().release();
+                DetectorExecutor::Instance().release();
+                ExpiryService::Instance().release();
+                WriteBehind::Instance().release();
+                InferenceService::Instance().release();
             } else {
                 LOG_F(ERROR, "[SERVER] Start server fail!");
                 return -1;
@@ -98,6 +174,22 @@ namespace GLCC {
         }
     }
 
+    void GLCCServer::preload_models(const Json::Value & detector_init_context) {
+        // the rooms all run the configured mode, load its model before the first request
+        const std::string mode = detector_init_context["mode"].asString();
+        const Json::Value mode_context = detector_init_context[(const char *)mode.c_str()];
+        if (!mode_context.isMember("model")) {
+            LOG_F(WARNING, "[SERVER] Find model of detector mode %s fail, load it on the first room", mode.c_str());
+            return;
+        }
+        int ret = InferenceService::Instance().preload(mode_context["model"].asString(),
+            mode_context["device"].asString(), mode_context["device_id"].asInt(),
+            constants::inference_warmup_width, constants::inference_warmup_height, constants::inference_num_warmups);
+        if (ret == -1) {
+            LOG_F(ERROR, "[SERVER] Preload model of detector mode %s fail, load it on the first room", mode.c_str());
+        }
+    }
+
     void GLCCServer::create_db_callbck(WFMySQLTask * task, void * context) {
         int * ex_state_ptr = (int *)context;
         int state = task->get_state();
@@ -116,9 +208,74 @@ namespace GLCC {
         std::stringstream connection_infos;
         get_connection_infos(task, connection_infos);
         LOG_F(INFO, "[SERVER] %s", connection_infos.str().c_str());
-        REGEX_FUNC(hello_world_callback, "GET", "/hello_world", task);
-        REGEX_FUNC(login_callback, "POST", "/login.*", task, context);
-        REGEX_FUNC(user_register_callback, "POST", "/register", task,  context);
+        if (!main_router.dispatch(task, context)) {
+            set_common_resp(task->get_resp(), "404", "Not Found");
+            LOG_F(WARNING, "[SERVER] No route for %s %s", 
+                task->get_req()->get_method(), task->get_req()->get_request_uri());
+        }
+    }
+
+    void GLCCServer::init_router() {
+        static std::once_flag once_flag;
+        std::call_once(once_flag, []() {
+            main_router.add(HttpMethodGet, "/hello_world", [](WFHttpTask * task, void * context) { hello_world_callback(task); });
+            main_router.add(HttpMethodGet, "/scheduler", [](WFHttpTask * task, void * context) { scheduler_callback(task); });
+            main_router.add(HttpMethodPost, "/register", user_register_callback);
+            main_router.add_prefix(HttpMethodPost, "/login", login_callback);
+
+            login_router.add(HttpMethodPost, "/login/dect_video", dect_video_callback);
+            login_router.add(HttpMethodPost, "/login/disdect_video", disdect_video_callback);
+            login_router.add(HttpMethodPost, "/login/register_video", register_video_callback);
+            login_router.add(HttpMethodPost, "/login/delete_video", delete_video_callback);
+            login_router.add(HttpMethodPost, "/login/put_lattice", video_put_lattice_callback);
+            login_router.add(HttpMethodPost, "/login/disput_lattice", video_disput_lattice_callback);
+            login_router.add(HttpMethodPost, "/login/delete_video_file", delete_video_file_callback);
+            login_router.add(HttpMethodPost, "/login/fetch_video_file", fetch_video_file_callback);
+            login_router.add(HttpMethodPost, "/login/dect_video_file", dect_video_file_callback);
+            login_router.add(HttpMethodPost, "/login/kick_dect_video_file", kick_dect_video_file_callback);
+            login_router.add(HttpMethodPost, "/login/transmiss_video_file", transmiss_video_file_callback);
+        });
+    }
+
+    void GLCCServer::init_statements() {
+        static std::once_flag once_flag;
+        std::call_once(once_flag, []() {
+            StatementCache & cache = StatementCache::Instance();
+            cache.add("login_user", "SELECT * FROM glccserver.User WHERE username=? AND password=?");
+            cache.add("fetch_contours", "SELECT contour_name, contour_path FROM glccserver.Contour "
+                "WHERE video_name=? AND username=?");
+
+            cache.add("login_dump", "SELECT video_name, video_url FROM glccserver.Video WHERE username=?;"
+                "SELECT glccserver.Contour.video_name as contour_video_name, glccserver.Contour.contour_name, "
+                "glccserver.Contour.contour_path from glccserver.Contour, glccserver.Video "
+                "where glccserver.Contour.video_name=glccserver.Video.video_name and glccserver.Video.username=? "
+                "and glccserver.Video.username=glccserver.Contour.username");
+            cache.add("register_user", "INSERT INTO glccserver.User(username, password, nickname) VALUES (?, ?, ?)");
+            cache.add("register_video", "INSERT INTO glccserver.Video(video_name, username, video_url) VALUES (?, ?, ?)");
+            cache.add("delete_video", "DELETE FROM glccserver.Video WHERE video_name=? AND username=?");
+            cache.add("fetch_video_files", "SELECT file_path, start_time, end_time FROM glccserver.File "
+                "WHERE username=? AND video_name=?");
+            cache.add("insert_contour", "INSERT INTO glccserver.Contour(username, contour_name, video_name, contour_path) "
+                "VALUES (?, ?, ?, ?)");
+            cache.add("delete_contour", "DELETE FROM glccserver.Contour WHERE contour_name=? AND video_name=? AND username=?");
+            cache.add("find_rooms", "SELECT room_name FROM glccserver.Room WHERE video_name=? AND username=?");
+            cache.add("delete_room", "DELETE FROM glccserver.Room WHERE room_name=?");
+            // range scans on the end_time indexes, one load window at a time
+            cache.add("load_file_expiries", "SELECT username, video_name, file_path, UNIX_TIMESTAMP(end_time) AS end_second "
+                "FROM glccserver.File WHERE end_time >= FROM_UNIXTIME(?) AND end_time < FROM_UNIXTIME(?)");
+            cache.add("load_room_expiries", "SELECT room_name, UNIX_TIMESTAMP(end_time) AS end_second "
+                "FROM glccserver.Room WHERE end_time >= FROM_UNIXTIME(?) AND end_time < FROM_UNIXTIME(?)");
+
+            // written behind by the detectors, a failing room row is skipped instead of failing its batch
+            WriteBehind & write_behind = WriteBehind::Instance();
+            write_behind.add("insert_file", "INSERT INTO glccserver.File(file_path, video_name, username, start_time, end_time) VALUES ",
+                "(?, ?, ?, now(), date_add(now(), INTERVAL ? DAY))");
+            write_behind.add("insert_room", "INSERT IGNORE INTO glccserver.Room(room_name, username, video_name, start_time, end_time) VALUES ",
+                "(?, ?, ?, now(), date_add(now(), INTERVAL ? DAY))");
+            write_behind.add("update_room", "UPDATE glccserver.Room SET start_time=now(), "
+                "end_time=date_add(now(), INTERVAL ? DAY) WHERE room_name IN (", "?", ")",
+                {constants::max_detector_live_day});
+        });
     }
 
     void GLCCServer::hello_world_callback(WFHttpTask * task) {
@@ -138,18 +295,18 @@ namespace GLCC {
         }
     }
 
+    void GLCCServer::scheduler_callback(WFHttpTask * task) {
+        protocol::HttpResponse * resp = task->get_resp();
+        set_common_resp(resp, "200", "OK", "HTTP/1.1", "application/json");
+        resp->append_output_body(RoomScheduler::Instance().get_state().toStyledString());
+    }
+
     void GLCCServer::login_activity(WFHttpTask * task, void * context) {
-        REGEX_FUNC(dect_video_callback, "POST", "/login/dect_video", task, context);
-        REGEX_FUNC(disdect_video_callback, "POST", "/login/disdect_video", task, context);
-        REGEX_FUNC(register_video_callback, "POST", "/login/register_video", task, context);
-        REGEX_FUNC(delete_video_callback, "POST", "/login/delete_video", task, context);
-        REGEX_FUNC(video_put_lattice_callback, "POST", "/login/put_lattice", task, context);
-        REGEX_FUNC(video_disput_lattice_callback, "POST", "/login/disput_lattice", task, context);
-        REGEX_FUNC(delete_video_file_callback, "POST", "/login/delete_video_file", task, context);
-        REGEX_FUNC(fetch_video_file_callback, "POST", "/login/fetch_video_file", task, context);
-        REGEX_FUNC(dect_video_file_callback, "POST", "/login/dect_video_file", task, context);
-        REGEX_FUNC(kick_dect_video_file_callback, "POST", "/login/kick_dect_video_file", task, context);
-        REGEX_FUNC(transmiss_video_file_callback, "POST", "/login/transmiss_video_file", task, context);
+        if (!login_router.dispatch(task, context)) {
+            set_common_resp(task->get_resp(), "404", "Not Found");
+            LOG_F(WARNING, "[SERVER][LOGIN] No route for %s %s", 
+                task->get_req()->get_method(), task->get_req()->get_request_uri());
+        }
     }
 
     void GLCCServer::login_callback(WFHttpTask * task, void * context) {
@@ -179,58 +336,78 @@ namespace GLCC {
             }
             std::string user_name = root["user_name"].asString();
             std::string user_password = root["user_password"].asString();
+            std::string token = root.get("token", "").asString();
+            if (token.empty()) {
+                std::string authorization;
+                protocol::HttpHeaderCursor cursor(req);
+                if (cursor.find("Authorization", authorization) && authorization.compare(0, 7, "Bearer ") == 0) {
+                    token = authorization.substr(7);
+                }
+            }
+            const std::string uri = req->get_request_uri();
+            if (!token.empty() && uri.substr(0, uri.find('?')) != "/login") {
+                if (SessionTable::Instance().check(token, user_name, user_password) == 0) {
+                    login_activity(task, context);
+                    return;
+                }
+                // an expired or evicted token falls back to the password check
+                LOG_F(INFO, "[SERVER][LOGIN][%s] Token is invalid, check password", user_name.c_str());
+            }
             Json::Value resp_root;
-            WFMySQLTask * mysql_task = WFTaskFactory::create_mysql_task(
-                constants::mysql_glccserver_url, 0, 
+            WFMySQLTask * mysql_task = StatementCache::Instance().create_task(
+                "login_user", {user_name, user_password},
                 [user_name, user_password, context](WFMySQLTask * task){
                     int state = task->get_state(); int error = task->get_error();
                     WFHttpTask * http_task = (WFHttpTask *)task->user_data;
                     protocol::HttpResponse * http_resp = http_task->get_resp();
                     Json::Value root;
                     if (state == WFT_STATE_SUCCESS) {
-                        std::unordered_map<std::string, std::vector<protocol::MySQLCell>> results;
-                        parse_mysql_response(task, results);
-                        const bool only_login = REGEX_VALUE("/login", http_task);
+                        std::vector<user_row_t> users;
+                        map_mysql_response(task, user_mapper(), users);
+                        const std::string uri = http_task->get_req()->get_request_uri();
+                        const bool only_login = uri.substr(0, uri.find('?')) == "/login";
                         auto & work_dir = ((glcc_server_context_t *)context)->server_dir.work_dir;
                         LOG_F(INFO, "[SERVER][LOGIN][%s] Only Login: %s", user_name.c_str(), only_login ? "yes" : "no");
-                        if (results.size() > 0) {
-                            if (user_name == results["username"][0].as_string() \
-                                && user_password == results["password"][0].as_string()) {
+                        if (users.size() > 0) {
+                            if (user_name == users[0].username && user_password == users[0].password) {
                                 if (only_login) {
-                                    WFMySQLTask * dump_info_task = WFTaskFactory::create_mysql_task(
-                                        constants::mysql_glccserver_url, 0,
-                                        [user_name, user_password, work_dir](WFMySQLTask * task) {
+                                    const std::string token = SessionTable::Instance().create(user_name, user_password);
+                                    if (token.empty()) {
+                                        set_common_resp(http_resp, "500", "Internal Server Error");
+                                        LOG_F(ERROR, "[SERVER][LOGIN][%s] Create session fail!", user_name.c_str());
+                                        return;
+                                    }
+                                    WFMySQLTask * dump_info_task = StatementCache::Instance().create_task(
+                                        "login_dump", {user_name, user_name},
+                                        [user_name, user_password, token, work_dir](WFMySQLTask * task) {
                                             int state = task->get_state(); int error = task->get_error();
                                             Json::Value reply;
                                             reply["user_name"] = user_name;
                                             reply["user_password"] = user_password;
+                                            reply["token"] = token;
                                             protocol::HttpResponse * up_resp = (protocol::HttpResponse *) task->user_data;
                                             if (state == WFT_STATE_SUCCESS) {
-                                                std::unordered_map<std::string, std::vector<protocol::MySQLCell>> results;
-                                                parse_mysql_response(task, results);
-                                                if (results.size() > 0) {
+                                                // the query holds two statements, videos come first and contours second
+                                                std::vector<video_row_t> videos;
+                                                std::vector<contour_row_t> contours;
+                                                protocol::MySQLResultCursor cursor(task->get_resp());
+                                                video_mapper().map(cursor, videos);
+                                                if (cursor.next_result_set()) {
+                                                    video_contour_mapper().map(cursor, contours);
+                                                }
+                                                if (videos.size() > 0 || contours.size() > 0) {
                                                     reply["msg"] = "login success";
-                                                    if (results.find("video_name") != results.end()) {
-                                                        std::vector<protocol::MySQLCell> & video_names =  results["video_name"];
-                                                        std::vector<protocol::MySQLCell> & video_urls = results["video_url"];
-                                                        for (int i = 0; i < (int)video_names.size(); i++) {
-                                                            reply["video_name"].append(video_names[i].as_string());
-                                                            reply["video_url"].append(video_urls[i].as_string());
-                                                        }
+                                                    for (auto & video : videos) {
+                                                        reply["video_name"].append(video.video_name);
+                                                        reply["video_url"].append(video.video_url);
                                                     }
-                                                    if (results.find("contour_name") != results.end()) {
-                                                        std::vector<protocol::MySQLCell> & contour_name =  results["contour_name"];
-                                                        std::vector<protocol::MySQLCell> & contour_path = results["contour_path"];
-                                                        std::vector<protocol::MySQLCell> & contour_video_name =  results["contour_video_name"];
-                                                        Json::Reader reader; Json::Value value;
-                                                        for (int i = 0; i < (int)contour_name.size(); i++) {
-                                                            value.clear();
-                                                            reply["contour_name"].append(contour_name[i].as_string());
-                                                            std::string contour_path_str = contour_path[i].as_string();
-                                                            reader.parse(contour_path_str, value);
-                                                            reply["contour_path"].append(value);
-                                                            reply["contour_video_name"].append(contour_video_name[i].as_string());
-                                                        }
+                                                    Json::Reader reader; Json::Value value;
+                                                    for (auto & contour : contours) {
+                                                        value.clear();
+                                                        reply["contour_name"].append(contour.contour_name);
+                                                        reader.parse(contour.contour_path, value);
+                                                        reply["contour_path"].append(value);
+                                                        reply["contour_video_name"].append(contour.video_name);
                                                     }
                                                     set_common_resp(up_resp, "200", "OK");
                                                     up_resp->append_output_body(reply.toStyledString());
@@ -253,16 +430,11 @@ namespace GLCC {
                                             }
                                         }
                                     );
+                                    if (dump_info_task == nullptr) {
+                                        set_common_resp(http_resp, "500", "Internal Server Error");
+                                        return;
+                                    }
                                     dump_info_task->user_data = http_resp;
-                                    char mysql_query[512];
-                                    std::snprintf(mysql_query, sizeof(mysql_query), 
-                                        "SELECT video_name, video_url FROM glccserver.Video WHERE username=\"%s\";"
-                                        "SELECT glccserver.Contour.video_name as contour_video_name, glccserver.Contour.contour_name,"
-                                        "glccserver.Contour.contour_path from glccserver.Contour, glccserver.Video "
-                                        "where glccserver.Contour.video_name=glccserver.Video.video_name and glccserver.Video.username=\"%s\" "
-                                        "and glccserver.Video.username=glccserver.Contour.username;", 
-                                        user_name.c_str(), user_name.c_str());
-                                    dump_info_task->get_req()->set_query(mysql_query);
                                     *series_of(task)<<dump_info_task;
                                 } else {
                                     login_activity(http_task, context);
@@ -283,16 +455,15 @@ namespace GLCC {
                         set_common_resp(http_resp, "400", "Bad Request");
                         root["msg"] = "Error user_name or user_password";
                         http_resp->append_output_body(root.toStyledString());
+            if (mysql_task == nullptr) {
+                set_common_resp(task->get_resp(), "500", "Internal Server Error");
+                return;
+            }
                         LOG_F(ERROR, "[SERVER][LOGIN][%s] Connect to mysql fail! Code: %d", user_name.c_str(), error);
                     }
                 }
             );
-            char mysql_query[256];
-            std::snprintf(mysql_query, sizeof(mysql_query), 
-                "SELECT * FROM User WHERE username=\"%s\" AND password=\"%s\";",
-                 user_name.c_str(), user_password.c_str());
             mysql_task->user_data = task;
-            mysql_task->get_req()->set_query(mysql_query);
             *series_of(task) << mysql_task;
         } else {
             LOG_F(ERROR, "[SERVER][LOGIN] Login fail! Code: %d", error);
@@ -326,8 +497,8 @@ namespace GLCC {
             std::string user_nickname = root["user_nickname"].asString();
 
             // creat sql task
-            WFMySQLTask * mysql_task = WFTaskFactory::create_mysql_task(
-                constants::mysql_glccserver_url, 0, 
+            WFMySQLTask * mysql_task = StatementCache::Instance().create_task(
+                "register_user", {user_name, user_password, user_nickname},
                 [user_name, user_password, user_nickname, work_dir](WFMySQLTask * task){
                     int state = task->get_state();
                     int error = task->get_error();
@@ -342,6 +513,8 @@ namespace GLCC {
                             std::string user_dir = work_dir + "/" + user_name;
                             std::string custom_dir = user_dir + "/" + "custom";
                             check_dir(user_dir, true); check_dir(custom_dir, true);
+                            // a user created again after being deleted must not reuse the old sessions
+                            SessionTable::Instance().invalidate_user(user_name);
                             set_common_resp(http_resp, "200", "OK");
                             LOG_F(INFO, "[SERVER][REGISTER][%s] Register success!", user_name.c_str());
                         }
@@ -351,12 +524,11 @@ namespace GLCC {
                     }
                 }
             );
+            if (mysql_task == nullptr) {
+                set_common_resp(task->get_resp(), "500", "Internal Server Error");
+                return;
+            }
             mysql_task->user_data = task;
-            char mysql_query[256];
-            std::snprintf(mysql_query, sizeof(mysql_query), 
-                "INSERT INTO glccserver.User(username, password, nickname) VALUES (\"%s\", \"%s\", \"%s\");",
-                 user_name.c_str(), user_password.c_str(), user_nickname.c_str());
-            mysql_task->get_req()->set_query(mysql_query);
             *series_of(task) << mysql_task;
         } else {
             LOG_F(ERROR, "[SERVER][REGISTER] Register fail! Code: %d", error);
@@ -602,47 +774,132 @@ namespace GLCC {
         std::string video_dir = user_dir + "/" + video_name;
         std::string video_path = video_dir + "/" + video_url;
 
+        struct stat st;
         int fd = open(video_path.c_str(), O_RDONLY);
-        if (fd >= 0) {
-            size_t size = lseek(fd, 0, SEEK_END);
-            void * buf = malloc(size);
-            WFFileIOTask * pread_task;
-            pread_task = WFTaskFactory::create_pread_task(
-                fd, buf, size, 0, 
-                [user_name, video_name, video_path](WFFileIOTask * task) {
+        if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            set_common_resp(resp, "404", "Not Found");
+            LOG_F(ERROR, "[SERVER][TRANSMISS_VIDEO_FILE][%s][%s] Find %s fail!", 
+                user_name.c_str(), video_name.c_str(), video_path.c_str());
+            return;
+        }
+        const size_t size = st.st_size;
+        const std::string etag = make_etag(st);
+        const std::string last_modified = make_http_date(st.st_mtim.tv_sec);
+        const std::string content_type = get_content_type(video_path);
+
+        std::string range, if_none_match, if_modified_since;
+        protocol::HttpHeaderCursor cursor(req);
+        cursor.find("Range", range);
+        cursor.rewind();
+        cursor.find("If-None-Match", if_none_match);
+        cursor.rewind();
+        cursor.find("If-Modified-Since", if_modified_since);
+
+        bool is_not_modified = false;
+        if (!if_none_match.empty()) {
+            is_not_modified = if_none_match == "*" || if_none_match.find(etag) != std::string::npos;
+        } else if (!if_modified_since.empty()) {
+            time_t since = parse_http_date(if_modified_since);
+            is_not_modified = since != -1 && st.st_mtim.tv_sec <= since;
+        }
+        if (is_not_modified) {
+            close(fd);
+            set_common_resp(resp, "304", "Not Modified", "HTTP/1.1", content_type);
+            resp->add_header_pair("ETag", etag);
+            resp->add_header_pair("Last-Modified", last_modified);
+            return;
+        }
+
+        size_t range_start = 0, range_end = size > 0 ? size - 1 : 0;
+        int range_state = range.empty() ? RANGE_NONE : parse_range(range, size, range_start, range_end);
+        if (range_state == RANGE_UNSATISFIABLE) {
+            close(fd);
+            set_common_resp(resp, "416", "Range Not Satisfiable", "HTTP/1.1", content_type);
+            resp->add_header_pair("Content-Range", "bytes */" + std::to_string(size));
+            LOG_F(WARNING, "[SERVER][TRANSMISS_VIDEO_FILE][%s][%s] Range %s of %s is unsatisfiable!", 
+                user_name.c_str(), video_name.c_str(), range.c_str(), video_path.c_str());
+            return;
+        }
+        const size_t chunk_size = ChunkPool::Instance().get_chunk_size();
+        const size_t window_size = std::max(constants::transmiss_max_range_chunks, (size_t)1) * chunk_size;
+        if (range_state == RANGE_NONE && size > window_size) {
+            // the body is held until the reply is sent, a whole file longer than one window is
+            // served as its first window, the player asks the rest by Range
+            range_state = RANGE_PARTIAL;
+        }
+        if (range_state == RANGE_PARTIAL) {
+            // the player asks the rest with the next range
+            range_end = std::min(range_end, range_start + window_size - 1);
+        }
+        const size_t length = size > 0 ? range_end - range_start + 1 : 0;
+        const size_t num_chunks = (length + chunk_size - 1) / chunk_size;
+
+        transmiss_context_t * transmiss_context = new transmiss_context_t;
+        transmiss_context->fd = fd;
+        ret = ChunkPool::Instance().acquire(num_chunks, transmiss_context->chunks);
+        if (ret == -1) {
+            close(fd);
+            delete transmiss_context;
+            set_common_resp(resp, "503", "Service Unavailable");
+            resp->add_header_pair("Retry-After", "1");
+            LOG_F(WARNING, "[SERVER][TRANSMISS_VIDEO_FILE][%s][%s] No buffer for %s, size: %lu", 
+                user_name.c_str(), video_name.c_str(), video_path.c_str(), (unsigned long)length);
+            return;
+        }
+
+        if (range_state == RANGE_PARTIAL) {
+            set_common_resp(resp, "206", "Partial Content", "HTTP/1.1", content_type);
+            resp->add_header_pair("Content-Range", "bytes " + std::to_string(range_start) + "-" + \
+                std::to_string(range_end) + "/" + std::to_string(size));
+        } else {
+            set_common_resp(resp, "200", "OK", "HTTP/1.1", content_type);
+        }
+        resp->add_header_pair("Accept-Ranges", "bytes");
+        resp->add_header_pair("ETag", etag);
+        resp->add_header_pair("Last-Modified", last_modified);
+
+        auto & chunks = transmiss_context->chunks;
+        for (size_t i = 0; i < num_chunks; i++) {
+            const size_t count = std::min(chunk_size, length - i * chunk_size);
+            WFFileIOTask * pread_task = WFTaskFactory::create_pread_task(
+                fd, chunks[i], count, range_start + i * chunk_size, 
+                [transmiss_context, count, user_name, video_name, video_path](WFFileIOTask * task) {
+                    if (transmiss_context->is_failed) {
+                        return;
+                    }
                     int state = task->get_state(); int error = task->get_error();
                     protocol::HttpResponse * up_resp = (protocol::HttpResponse *) task->user_data;
                     FileIOArgs * args = task->get_args(); auto ret = task->get_retval();
-                    close(args->fd);
-                    if (state == WFT_STATE_SUCCESS) {
-                        set_common_resp(up_resp, "200", "OK", "HTTP/1.1", "image/jpeg");
+                    if (state == WFT_STATE_SUCCESS && ret == (long)count) {
                         up_resp->append_output_body_nocopy(args->buf, ret);
-                        LOG_F(INFO, "[SERVER][TRANSMISS_VIDEO_FILE][%s][%s] Transmiss %s success!",
-                            user_name.c_str(), video_name.c_str(), video_path.c_str());
                     } else {
-                        set_common_resp(up_resp, "404", "Not Found");
-                        LOG_F(ERROR, "[SERVER][TRANSMISS_VIDEO_FILE][%s][%s] Write %s fail! Code: %d", 
+                        transmiss_context->is_failed = true;
+                        up_resp->clear_output_body();
+                        up_resp->set_status_code("500");
+                        up_resp->set_reason_phrase("Internal Server Error");
+                        LOG_F(ERROR, "[SERVER][TRANSMISS_VIDEO_FILE][%s][%s] Read %s fail! Code: %d", 
                             user_name.c_str(), video_name.c_str(), video_path.c_str(), error);
                     }
                 }
             );
             pread_task->user_data = resp;
-            series->set_context(buf);
-            task->set_callback(
-                [user_name, video_name, video_path](WFHttpTask * task) {
-                    SeriesWork * series = series_of(task);
-                    void * buf = series->get_context();
-                    free(buf);
-                    LOG_F(INFO, "[SERVER][TRANSMISS_VIDEO_FILE][%s][%s] Release %s buf success!",
-                        user_name.c_str(), video_name.c_str(), video_path.c_str());
-                }
-            );
             *series << pread_task;
-        } else {
-            set_common_resp(resp, "404", "Not Found");
-            LOG_F(ERROR, "[SERVER][TRANSMISS_VIDEO_FILE][%s][%s] Write %s fail!", 
-                user_name.c_str(), video_name.c_str(), video_path.c_str());
         }
+        task->set_callback(
+            [transmiss_context, range_start, length, user_name, video_name, video_path](WFHttpTask * task) {
+                close(transmiss_context->fd);
+                ChunkPool::Instance().release(transmiss_context->chunks);
+                if (!transmiss_context->is_failed) {
+                    LOG_F(INFO, "[SERVER][TRANSMISS_VIDEO_FILE][%s][%s] Transmiss %s [%lu, +%lu) success!",
+                        user_name.c_str(), video_name.c_str(), video_path.c_str(), 
+                        (unsigned long)range_start, (unsigned long)length);
+                }
+                delete transmiss_context;
+            }
+        );
     }
 
     void GLCCServer::delete_video_file_callback(WFHttpTask * task, void * context) {
@@ -708,10 +965,12 @@ namespace GLCC {
             }
         }
 
-        WFMySQLTask * mysql_task;
-
-        mysql_task = WFTaskFactory::create_mysql_task(
-            constants::mysql_glccserver_url, 0, 
+        sql_params_t delete_files_params{user_name, video_name};
+        delete_files_params.insert(delete_files_params.end(), delete_success_file.begin(), delete_success_file.end());
+        const std::string delete_files_query = "DELETE FROM glccserver.File WHERE username=? AND video_name=? "
+            "AND file_path IN (" + sql_placeholders(delete_success_file.size()) + ")";
+        WFMySQLTask * mysql_task = StatementCache::Instance().create_query_task(
+            delete_files_query, delete_files_params,
             [user_name, video_name](WFMySQLTask * task){
                 int state = task->get_state(); int error = task->get_error();
                 if (state == WFT_STATE_SUCCESS) {
@@ -723,20 +982,10 @@ namespace GLCC {
                 }
             }
         );
-
-        // letter accumulate function
-        auto accumulate_func = [](std::string & x, std::string & y) {
-            return x.empty() ? ("\"" + y + "\"") : (x + "," + "\"" + y + "\"");
-        };
-
-        auto file_str_concat = join(delete_success_file, "", accumulate_func); 
-        std::stringstream mysql_delete_query;
-        mysql_delete_query << "delete from glccserver.FILE where "
-                           << "username=" << "\"" << user_name << "\""  << " and "
-                           << "video_name=" << "\"" << video_name << "\""  << " and " 
-                           << "file_path in (" << file_str_concat << ");";
-
-        mysql_task->get_req()->set_query(mysql_delete_query.str());
+        if (mysql_task == nullptr) {
+            set_common_resp(resp, "500", "Internal Server Error");
+            return;
+        }
         *series_of(task) << mysql_task;
         set_common_resp(resp, "200", "OK");
     }
@@ -780,71 +1029,62 @@ namespace GLCC {
             for (auto i = 0; i < (int)root["video_name"].size(); i++) {
                 video_names.emplace_back(root["video_name"][i].asString());
             }
-            WFMySQLTask * mysql_task = WFTaskFactory::create_mysql_task(
-                constants::mysql_glccserver_url, 0, 
+            sql_params_t fetch_files_params{user_name};
+            fetch_files_params.insert(fetch_files_params.end(), video_names.begin(), video_names.end());
+            const std::string fetch_files_query = "SELECT video_name, file_path, start_time, end_time FROM glccserver.File "
+                "WHERE username=? AND video_name IN (" + sql_placeholders(video_names.size()) + ")";
+            WFMySQLTask * mysql_task = StatementCache::Instance().create_query_task(
+                fetch_files_query, fetch_files_params,
                 [user_name] (WFMySQLTask * task) {
                     int state = task->get_state(); int error = task->get_error();
                     SeriesWork * series = series_of(task);
                     WFHttpTask * up_task = (WFHttpTask *) series->get_context(); 
                     protocol::HttpResponse * up_resp = (protocol::HttpResponse *) up_task->get_resp();
                     Json::Value reply;
+                    std::vector<thumbnail_wait_t> pending_covers;
                     if (state == WFT_STATE_SUCCESS) {
-                        std::unordered_map<std::string, std::vector<protocol::MySQLCell>> results;
-                        int parse_state = parse_mysql_response(task, results);
+                        std::vector<file_row_t> files;
+                        int parse_state = map_mysql_response(task, video_file_mapper(), files);
                         if (parse_state == WFT_STATE_SUCCESS) {
-                            if (results.size() > 0) {
-                                if (results.find("video_name") != results.end()) {
-                                    auto & video_names = results["video_name"];
-                                    auto & file_paths = results["file_path"];
-                                    auto & start_times = results["start_time"];
-                                    auto & end_times = results["end_time"];
-                                    std::string video_name;
-                                    std::string file_path;
-                                    std::string start_time;
-                                    std::string end_time;
-                                    for (auto i = 0; i < (int)video_names.size(); i++) {
-                                        video_name = video_names[i].as_string();
-                                        file_path = file_paths[i].as_string();
-                                        start_time = start_times[i].as_string();
-                                        end_time = end_times[i].as_string();
-
-                                        std::unordered_map<std::string, std::string> path_parse_results;
-                                        int ret = parse_path(file_path, path_parse_results);
-                                        if (ret == -1) {
-                                            continue;
-                                            LOG_F(WARNING, "[SERVER][FETCH_VIDEO_FILE][%s][%s] Parse %s fail!", 
-                                                user_name.c_str(), video_name.c_str(), file_path.c_str());
-                                        }
-                                        auto & dirname = path_parse_results["dirname"];
-                                        auto & stem = path_parse_results["stem"];
-                                        auto & basename = path_parse_results["basename"];
-                                        std::string cover_path = dirname + "/" + stem + "." + constants::cover_save_suffix;
-                                        if (check_file(cover_path) < 0) {
-                                            LOG_F(WARNING, "[SERVER][FETCH_VIDEO_FILE][%s][%s] %s don't exist! Will create one", 
-                                                user_name.c_str(), video_name.c_str(), cover_path.c_str());
-                                            std::string command = "ffmpeg -y -i " + file_path + " -ss 1 -frames:v 1 " + cover_path;
-                                            system(command.c_str());
-                                        }
-                                        Json::Value item;
-                                        item["video_url"] = basename;
-                                        item["start_time"] = start_time;
-                                        item["end_time"] = end_time;
-                                        reply[video_name].append(item);
+                            if (files.size() > 0) {
+                                for (auto & file : files) {
+                                    const std::string & video_name = file.video_name;
+                                    const std::string & file_path = file.file_path;
+
+                                    std::unordered_map<std::string, std::string> path_parse_results;
+                                    int ret = parse_path(file_path, path_parse_results);
+                                    if (ret == -1) {
+                                        continue;
+                                        LOG_F(WARNING, "[SERVER][FETCH_VIDEO_FILE][%s][%s] Parse %s fail!", 
+                                            user_name.c_str(), video_name.c_str(), file_path.c_str());
                                     }
-                                    set_common_resp(up_resp, "200", "OK");
-                                    LOG_F(INFO, "[SERVER][FETCH_VIDEO_FILE][%s] Fetch video files success! Body: %s", 
-                                        user_name.c_str(), reply.toStyledString().c_str());
-                                } else {
-                                    set_common_resp(up_resp, "404", "Not Found");
-                                    LOG_F(WARNING, "[SERVER][FETCH_VIDEO_FILE][%s] Fetch video files fail!", 
-                                        user_name.c_str());
+                                    auto & basename = path_parse_results["basename"];
+                                    std::shared_future<int> cover_result;
+                                    int cover_state = ThumbnailService::Instance().request(file_path, &cover_result);
+                                    if (cover_state == THUMBNAIL_PENDING || cover_state == THUMBNAIL_REJECT) {
+                                        LOG_F(WARNING, "[SERVER][FETCH_VIDEO_FILE][%s][%s] Cover of %s don't exist! %s", 
+                                            user_name.c_str(), video_name.c_str(), file_path.c_str(),
+                                            cover_state == THUMBNAIL_PENDING ? "Will create one" : "Queue is full");
+                                    }
+                                    Json::Value item;
+                                    item["video_url"] = basename;
+                                    item["start_time"] = file.start_time;
+                                    item["end_time"] = file.end_time;
+                                    item["cover_ready"] = cover_state == THUMBNAIL_READY;
+                                    if (cover_state == THUMBNAIL_PENDING) {
+                                        pending_covers.push_back({video_name, (int)reply[video_name].size(), cover_result});
+                                    }
+                                    reply[video_name].append(item);
                                 }
+                                set_common_resp(up_resp, "200", "OK");
+                                LOG_F(INFO, "[SERVER][FETCH_VIDEO_FILE][%s] Fetch video files success! Body: %s", 
+                                    user_name.c_str(), reply.toStyledString().c_str());
                             } else {
                                 set_common_resp(up_resp, "404", "Not Found");
                                 LOG_F(WARNING, "[SERVER][FETCH_VIDEO_FILE][%s] Fetch zero recorder!",
                                     user_name.c_str());
                             }
-                            up_resp->append_output_body(reply.toStyledString());
+                            reply_video_files(series, up_resp, std::move(reply), std::move(pending_covers));
                         } else {
                             set_common_resp(up_resp, "400", "Bad Request");
                             LOG_F(ERROR, "[SERVER][FETCH_VIDEO_FILE][%s] Parse mysql results task fail! Code: %d",
@@ -857,77 +1097,60 @@ namespace GLCC {
                     }
                 }
             );
-            auto accumulate_func = [](std::string & x, std::string & y) {
-                return x.empty() ? ("\"" + y + "\"") : (x + "," + "\"" + y + "\"");
-            };
-
-            auto video_name_concat = join(video_names, "", accumulate_func);
-            std::stringstream mysql_check_query;
-            mysql_check_query << "SELECT video_name, file_path, start_time, end_time FROM glccserver.File WHERE "
-                              << "username=" << "\"" << user_name << "\"" << " AND "
-                              << "video_name IN (" << video_name_concat << ");";
-            mysql_task->get_req()->set_query(mysql_check_query.str());
+            if (mysql_task == nullptr) {
+                set_common_resp(task->get_resp(), "500", "Internal Server Error");
+                return;
+            }
             series->set_context(task);
             *series << mysql_task;
         } else {
             std::string video_name = root["video_name"].asString();
-            WFMySQLTask * mysql_task = WFTaskFactory::create_mysql_task(
-                constants::mysql_glccserver_url, 0, 
+            WFMySQLTask * mysql_task = StatementCache::Instance().create_task(
+                "fetch_video_files", {user_name, video_name},
                 [user_name, video_name] (WFMySQLTask * task) {
                     int state = task->get_state(); int error = task->get_error();
                     SeriesWork * series = series_of(task);
                     WFHttpTask * up_task = (WFHttpTask *) series->get_context(); 
                     protocol::HttpResponse * up_resp = (protocol::HttpResponse *) up_task->get_resp();
                     Json::Value reply;
+                    std::vector<thumbnail_wait_t> pending_covers;
                     if (state == WFT_STATE_SUCCESS) {
-                        std::unordered_map<std::string, std::vector<protocol::MySQLCell>> results;
-                        int parse_state = parse_mysql_response(task, results);
+                        std::vector<file_row_t> files;
+                        int parse_state = map_mysql_response(task, file_mapper(), files);
                         if (parse_state == WFT_STATE_SUCCESS) {
-                            if (results.size() > 0) {
-                                if (results.find("file_path") != results.end()) {
-                                    auto & file_paths = results["file_path"];
-                                    auto & start_times = results["start_time"];
-                                    auto & end_times = results["end_time"];
-                                    std::string file_path;
-                                    std::string start_time;
-                                    std::string end_time;
-                                    for (auto i = 0; i < (int)file_paths.size(); i++) {
-                                        file_path = file_paths[i].as_string();
-                                        start_time = start_times[i].as_string();
-                                        end_time = end_times[i].as_string();
-                                        std::unordered_map<std::string, std::string> path_parse_results;
-                                        int ret = parse_path(file_path, path_parse_results);
-                                        if (ret == -1) {
-                                            continue;
-                                            LOG_F(ERROR, "[SERVER][FETCH_VIDEO_FILE][%s] Parse %s fail!", 
-                                                user_name.c_str(), file_path.c_str());
-                                        }
-                                        auto & dirname = path_parse_results["dirname"];
-                                        auto & stem = path_parse_results["stem"];
-                                        auto & basename = path_parse_results["basename"];
-
-                                        std::string cover_path = dirname + "/" + stem + constants::cover_save_suffix;
-                                        if (check_file(cover_path) < 0) {
-                                            LOG_F(WARNING, "[SERVER][FETCH_VIDEO_FILE][%s] %s don't exist!", 
-                                                user_name.c_str(), cover_path.c_str());
-                                            std::string command = "ffmpeg -y -i " + file_path + " -ss 1 -frames:v 1 " + cover_path;
-                                            system(command.c_str());
-                                        }
-                                        Json::Value item;
-                                        item["video_url"] = basename;
-                                        item["start_time"] = start_time;
-                                        item["end_time"] = end_time;
-                                        reply[video_name].append(item);
+                            if (files.size() > 0) {
+                                for (auto & file : files) {
+                                    const std::string & file_path = file.file_path;
+                                    std::unordered_map<std::string, std::string> path_parse_results;
+                                    int ret = parse_path(file_path, path_parse_results);
+                                    if (ret == -1) {
+                                        continue;
+                                        LOG_F(ERROR, "[SERVER][FETCH_VIDEO_FILE][%s] Parse %s fail!", 
+                                            user_name.c_str(), file_path.c_str());
                                     }
-                                } else {
-                                    LOG_F(WARNING, "[SERVER][FETCH_VIDEO_FILE][%s] Fetch video files fail!", 
-                                        user_name.c_str());
+                                    auto & basename = path_parse_results["basename"];
+                                    std::shared_future<int> cover_result;
+                                    int cover_state = ThumbnailService::Instance().request(file_path, &cover_result);
+                                    if (cover_state == THUMBNAIL_PENDING || cover_state == THUMBNAIL_REJECT) {
+                                        LOG_F(WARNING, "[SERVER][FETCH_VIDEO_FILE][%s] Cover of %s don't exist! %s", 
+                                            user_name.c_str(), file_path.c_str(),
+                                            cover_state == THUMBNAIL_PENDING ? "Will create one" : "Queue is full");
+                                    }
+                                    Json::Value item;
+                                    item["video_url"] = basename;
+                                    item["start_time"] = file.start_time;
+                                    item["end_time"] = file.end_time;
+                                    item["cover_ready"] = cover_state == THUMBNAIL_READY;
+                                    if (cover_state == THUMBNAIL_PENDING) {
+                                        pending_covers.push_back({video_name, (int)reply[video_name].size(), cover_result});
+                                    }
+                                    reply[video_name].append(item);
                                 }
                             } else {
                                 LOG_F(WARNING, "[SERVER][FETCh_VIDEO_FILE][%s] Fetch zero recorder!",
                                     user_name.c_str());
                             }
-                            up_resp->append_output_body(reply.toStyledString());
+                            reply_video_files(series, up_resp, std::move(reply), std::move(pending_covers));
                         } else {
                             set_common_resp(up_resp, "400", "Bad Request");
                             LOG_F(ERROR, "[SERVER][FETCH_VIDEO_FILE][%s] Parse mysql results task fail!",
@@ -940,17 +1163,57 @@ namespace GLCC {
                     }
                 }
             );
-            std::stringstream mysql_check_query;
-            mysql_check_query << "select file_path, start_time, end_time from glccserver.FILE where "
-                              << "username=" << "\"" << user_name << "\""
-                              << "video_name=" << "\"" << video_name << "\"" 
-                              << ";";
-            mysql_task->get_req()->set_query(mysql_check_query.str());
+            if (mysql_task == nullptr) {
+                set_common_resp(task->get_resp(), "500", "Internal Server Error");
+                return;
+            }
             series->set_context(task);
             *series << mysql_task;
         }
     }
 
+    void GLCCServer::reply_video_files(SeriesWork * series, protocol::HttpResponse * resp, 
+                                       Json::Value && reply, std::vector<thumbnail_wait_t> && pending_covers) {
+        if (pending_covers.empty() || constants::thumbnail_policy != WAIT_POLICY) {
+            resp->append_output_body(reply.toStyledString());
+            return;
+        }
+        // poll the covers on timers in the series, no thread blocks, the reply is sent once the series ends
+        auto reply_ptr = std::make_shared<Json::Value>(std::move(reply));
+        auto pending_ptr = std::make_shared<std::vector<thumbnail_wait_t>>(std::move(pending_covers));
+        wait_covers(series, resp, reply_ptr, pending_ptr, std::chrono::steady_clock::now() + \
+            std::chrono::milliseconds(constants::thumbnail_wait_millisecond));
+    }
+
+    void GLCCServer::wait_covers(SeriesWork * series, protocol::HttpResponse * resp,
+                                 std::shared_ptr<Json::Value> reply, std::shared_ptr<std::vector<thumbnail_wait_t>> pending_covers,
+                                 const std::chrono::steady_clock::time_point deadline) {
+        auto & covers = *pending_covers;
+        covers.erase(std::remove_if(covers.begin(), covers.end(), [&reply](thumbnail_wait_t & cover) {
+            if (cover.result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                return false;
+            }
+            if (cover.result.get() == 0) {
+                (*reply)[cover.key][cover.index]["cover_ready"] = true;
+            }
+            return true;
+        }), covers.end());
+        const auto now = std::chrono::steady_clock::now();
+        if (covers.empty() || now >= deadline) {
+            resp->append_output_body(reply->toStyledString());
+            return;
+        }
+        const long wait_microsecond = std::min((long)std::chrono::duration_cast<std::chrono::microseconds>(deadline - now).count(),
+            thumbnail_poll_millisecond * 1000);
+        WFTimerTask * timer_task = WFTaskFactory::create_timer_task(wait_microsecond / constants::num_microsecond_per_second,
+            (wait_microsecond % constants::num_microsecond_per_second) * 1000,
+            [resp, reply, pending_covers, deadline](WFTimerTask * task) {
+                wait_covers(series_of(task), resp, reply, pending_covers, deadline);
+            }
+        );
+        series->push_back(timer_task);
+    }
+
 
     void GLCCServer::dect_video_callback(WFHttpTask * task, void * context) {
         protocol::HttpRequest * req = task->get_req();
@@ -1010,17 +1273,40 @@ namespace GLCC {
             // cv::VideoCapture capture;
             // int ret = capture.open(video_url);
             // capture.release();
-            WFGoTask * go_run_task = WFTaskFactory::create_go_task(
-                "detector_run", run_detector, dect_context->livego_context.room_name, dect_context);
-            go_run_task->set_callback([dect_context, user_name, video_name](WFGoTask * task) {
-                std::string & room_name = dect_context->livego_context.room_name;
-                LOG_F(INFO, "[SERVER][DECT][%s][%s][%s] Detect task finish!", 
-                    user_name.c_str(), video_name.c_str(), room_name.c_str());
-            });
-            go_run_task->start();
+            const int priority = root.get("priority", 0).asInt();
+            const int target_fps = root.get("fps", constants::scheduler_default_target_fps).asInt();
+            // the room holds an executor worker until its detector stops, off the compute threads
+            int admission = RoomScheduler::Instance().admit(room_name, priority, target_fps,
+                [dect_context, user_name, video_name](std::shared_ptr<room_quota_t> quota) {
+                    dect_context->detector_run_context.quota = quota;
+                    int ret = DetectorExecutor::Instance().submit(dect_context->livego_context.room_name,
+                        [dect_context, user_name, video_name, quota]() {
+                            std::string & room_name = dect_context->livego_context.room_name;
+                            run_detector(room_name, dect_context);
+                            LOG_F(INFO, "[SERVER][DECT][%s][%s][%s] Detect task finish!", 
+                                user_name.c_str(), video_name.c_str(), room_name.c_str());
+                        },
+                        [quota]() {
+                            // after the worker is free, so the queued room the leave starts can take it
+                            RoomScheduler::Instance().leave(quota);
+                        });
+                    if (ret == -1) {
+                        // the scheduler takes the room out again, a request waiting on it is answered 503
+                        LOG_F(ERROR, "[SERVER][DECT][%s][%s][%s] No detector worker left!", 
+                            user_name.c_str(), video_name.c_str(), dect_context->livego_context.room_name.c_str());
+                    }
+                    return ret;
+                });
+            if (admission == ROOM_REJECTED) {
+                set_common_resp(resp, "503", "Service Unavailable");
+                LOG_F(ERROR, "[SERVER][DECT][%s][%s][%s] No capacity left for the room!", 
+                    user_name.c_str(), video_name.c_str(), room_name);
+                return;
+            }
             set_common_resp(resp, "200", "OK");
             Json::Value reply;
             reply["room_name"] = room_name;
+            reply["admission"] = admission == ROOM_ADMITTED ? "admitted" : "queued";
             // TODO: append body nocopy
             resp->append_output_body(reply.toStyledString());
         } else {
@@ -1143,8 +1429,8 @@ namespace GLCC {
         video_url = video_path;
         LOG_F(INFO, "[SERVER][REGISTER_VIDEO][%s][%s] Register %s", 
             user_name.c_str(), video_name.c_str(), video_path);
-        WFMySQLTask * mysql_task = WFTaskFactory::create_mysql_task(
-            constants::mysql_glccserver_url, 0, 
+        WFMySQLTask * mysql_task = StatementCache::Instance().create_task(
+            "register_video", {video_name, user_name, video_url},
             [video_url, video_name, user_name, video_dir](WFMySQLTask * task){
                 int state = task->get_state(); int error = task->get_error();
                 WFHttpTask * http_task = (WFHttpTask *) task->user_data;
@@ -1172,14 +1458,11 @@ namespace GLCC {
                 }
             }
         );
+        if (mysql_task == nullptr) {
+            set_common_resp(task->get_resp(), "500", "Internal Server Error");
+            return;
+        }
         mysql_task->user_data = task;
-
-        std::stringstream mysql_query;
-        mysql_query << "INSERT INTO glccserver.Video(video_name, username, video_url) values ("
-                    << "\"" << video_name << "\"" << ", " 
-                    << "\"" << user_name << "\"" << ", "
-                    << "\"" << video_url << "\"" << ");";
-        mysql_task->get_req()->set_query(mysql_query.str());
         *series_of(task) << mysql_task;
     }
 
@@ -1204,8 +1487,8 @@ namespace GLCC {
 
         std::string video_name = root["video_name"].asString();
         LOG_F(INFO, "Body: %s", root.toStyledString().c_str());
-        WFMySQLTask * mysql_task = WFTaskFactory::create_mysql_task(
-            constants::mysql_glccserver_url, 0, 
+        WFMySQLTask * mysql_task = StatementCache::Instance().create_task(
+            "delete_video", {video_name, user_name},
             [user_name, video_name](WFMySQLTask * task) {
                 int state = task->get_state(); int error = task->get_error();
                 WFHttpTask * http_task = (WFHttpTask *) task->user_data;
@@ -1225,11 +1508,11 @@ namespace GLCC {
                 }
             }
         );
+        if (mysql_task == nullptr) {
+            set_common_resp(task->get_resp(), "500", "Internal Server Error");
+            return;
+        }
         mysql_task->user_data = task;
-        char mysql_query[512];
-        std::snprintf(mysql_query, sizeof(mysql_query),
-            "DELETE FROM glccserver.Video WHERE video_name=\"%s\" AND username=\"%s\"", video_name.c_str(), user_name.c_str());
-        mysql_task->get_req()->set_query(mysql_query);
         *series_of(task) << mysql_task;
     }
 
@@ -1291,8 +1574,9 @@ namespace GLCC {
         );
 
         go_task->set_callback([reply_ptr, resp, root](WFGoTask * task) {
-            WFMySQLTask * mysql_task = WFTaskFactory::create_mysql_task(
-                constants::mysql_glccserver_url, 0,
+            WFMySQLTask * mysql_task = StatementCache::Instance().create_task(
+                "insert_contour", {(*reply_ptr)["user_name"].asString(), (*reply_ptr)["contour_name"].asString(),
+                    (*reply_ptr)["video_name"].asString(), (*reply_ptr)["contour_path"].toStyledString()},
                 [reply_ptr, resp, root](WFMySQLTask * task){
                     std::string video_name = root["video_name"].asString();
                     std::string contour_name = root["contour_name"].asString();
@@ -1303,23 +1587,24 @@ namespace GLCC {
                         if (parse_state == WFT_STATE_SUCCESS) {
                             set_common_resp(resp, "200", "OK");
                             resp->append_output_body((*reply_ptr).toStyledString());
-                            WFMySQLTask * mysql_task = WFTaskFactory::create_mysql_task(
-                                constants::mysql_glccserver_url, 0, 
+                            WFMySQLTask * mysql_task = StatementCache::Instance().create_task(
+                                "find_rooms", {video_name, user_name},
                                 [user_name, video_name, contour_name, reply_ptr](WFMySQLTask * task){
                                     int state = task->get_state(); int error = task->get_error();
                                     if (state == WFT_STATE_SUCCESS) {
-                                        std::unordered_map<std::string, std::vector<protocol::MySQLCell>> results;
-                                        parse_mysql_response(task, results);
-                                        if (results.size() > 0) {
-                                            std::vector<protocol::MySQLCell> & room_name = results["room_name"];
-                                            for (int i = 0; i < (int)room_name.size(); i++) {
-                                                Detector * detector = ProductFactory<Detector>::Instance().GetProduct(room_name[i].as_string());
+                                        std::vector<room_row_t> rooms;
+                                        map_mysql_response(task, room_mapper(), rooms);
+                                        if (rooms.size() > 0) {
+                                            for (auto & room : rooms) {
+                                                std::shared_ptr<Detector> detector = ProductFactory<Detector>::Instance().GetProduct(room.room_name);
                                                 if (detector != nullptr) {
                                                     Json::Value contour_path = (*reply_ptr)["contour_path"];
+                                                    std::vector<cv::Point> points_list;
                                                     for (int j = 0; j < (int)contour_path.size() / 2; j++) {
-                                                        detector->contour_list[contour_name].emplace_back(contour_path[j * 2].asInt(), 
+                                                        points_list.emplace_back(contour_path[j * 2].asInt(), 
                                                             contour_path[j * 2 + 1].asInt());
                                                     }
+                                                    detector->set_contour(contour_name, points_list);
                                                     detector->is_put_lattice = true;
                                                 }
                                             }
@@ -1333,12 +1618,9 @@ namespace GLCC {
                                     }
                                 }
                             );
-                            char mysql_query[512];
-                            std::snprintf(mysql_query, sizeof(mysql_query), 
-                                "SELECT room_name from glccserver.Room where video_name=\"%s\" AND username=\"%s\";", 
-                                video_name.c_str(), user_name.c_str());
-                            mysql_task->get_req()->set_query(mysql_query);
-                            mysql_task->start();
+                            if (mysql_task != nullptr) {
+                                mysql_task->start();
+                            }
                             LOG_F(INFO, "[SERVER][PUT_LATTICE][%s][%s] Insert %s into Contour success!",
                                 user_name.c_str(), video_name.c_str(), contour_name.c_str());
                         } else {
@@ -1353,12 +1635,10 @@ namespace GLCC {
                     }
                 }
             );
-            std::stringstream mysql_query;
-            mysql_query << "INSERT glccserver.Contour(username, contour_name, video_name, contour_path) VALUES ("
-                        << (*reply_ptr)["user_name"] << "," << (*reply_ptr)["contour_name"] << "," << (*reply_ptr)["video_name"] << "," 
-                        << "\"" <<(*reply_ptr)["contour_path"].toStyledString() << "\""
-                        << ");";
-            mysql_task->get_req()->set_query(mysql_query.str());
+            if (mysql_task == nullptr) {
+                set_common_resp(resp, "500", "Internal Server Error");
+                return;
+            }
             *series_of(task) << mysql_task;
         });
         *series_of(task) << go_task;
@@ -1390,17 +1670,17 @@ namespace GLCC {
         std::string video_name = root["video_name"].asString();
         std::string contour_name = root["contour_name"].asString();
 
-        WFMySQLTask * mysql_task = WFTaskFactory::create_mysql_task(
-            constants::mysql_glccserver_url, 0, 
+        WFMySQLTask * mysql_task = StatementCache::Instance().create_task(
+            "delete_contour", {contour_name, video_name, user_name},
             [resp, user_name, user_password, video_name, contour_name](WFMySQLTask * task){
                 int state = task->get_state(); int error = task->get_error();
                 if (state == WFT_STATE_SUCCESS) {
                     int parse_state = parse_mysql_response(task);
                     if (parse_state == WFT_STATE_SUCCESS) {
                         std::string room_name = user_name + "_" + user_password + "_" + video_name.c_str();
-                        Detector * detector = ProductFactory<Detector>::Instance().GetProduct(room_name);
+                        std::shared_ptr<Detector> detector = ProductFactory<Detector>::Instance().GetProduct(room_name);
                         if (detector != nullptr) {
-                            detector->contour_list.erase(contour_name);
+                            detector->erase_contour(contour_name);
                             LOG_F(INFO, "[SERVER][DISPUT_LATTICE][%s][%s] Delete %s from Contour success", 
                                 user_name.c_str(), video_name.c_str(), contour_name.c_str());
                         } else {
@@ -1420,12 +1700,11 @@ namespace GLCC {
                 }
             }
         );
+        if (mysql_task == nullptr) {
+            set_common_resp(resp, "500", "Internal Server Error");
+            return;
+        }
 
-        char mysql_query[256];
-        std::snprintf(mysql_query, sizeof(mysql_query), 
-            "DELETE FROM glccserver.Contour WHERE contour_name=\"%s\" AND video_name=\"%s\" AND username=\"%s\";",
-            contour_name.c_str(), video_name.c_str(), user_name.c_str());
-        mysql_task->get_req()->set_query(mysql_query);
         *series_of(task) << mysql_task;
     }
 
@@ -1476,21 +1755,6 @@ namespace GLCC {
         GLCCServer::mysql_wait_group.done();
     }
 
-    bool GLCCServer::parse_request(WFHttpTask * task, 
-                                  std::string _med, 
-                                  std::string _uri) {
-        protocol::HttpRequest * req = task->get_req();
-        std::string uri = req->get_request_uri();
-        std::string med = req->get_method();
-        std::stringstream med_regex_str;
-        med_regex_str << "^" << _med << "$";
-        std::regex med_regex(med_regex_str.str(), std::regex_constants::icase);
-        std::regex uri_regex(_uri);
-        bool ret1 = std::regex_match(med, med_regex);
-        bool ret2 = std::regex_match(uri, uri_regex);
-        return ret1 && ret2;
-    }
-    
     void GLCCServer::get_connection_infos(WFHttpTask * task, std::iostream & context) {
         auto seq = task->get_task_seq();
         char addrstr[INET6_ADDRSTRLEN];
@@ -1606,155 +1870,139 @@ namespace GLCC {
         context["port"] = port;
     }
 
-    void GLCCServer::file_timer_callback(WFTimerTask * timer) {
-        SeriesWork * series = series_of(timer);
-        WFMySQLTask * mysql_task = WFTaskFactory::create_mysql_task(
-            constants::mysql_glccserver_url, 0, 
-            [](WFMySQLTask * task){
-                int state = task->get_state(); int error = task->get_error();
-                if (state == WFT_STATE_SUCCESS) {
-                    std::unordered_map<std::string, std::vector<protocol::MySQLCell>> results;
-                    parse_mysql_response(task, results);
-                    if (results.size() > 0) {
-                        std::vector<protocol::MySQLCell> & user_name_cells = results["username"];
-                        std::vector<protocol::MySQLCell> & video_name_cells = results["video_name"];
-                        std::vector<protocol::MySQLCell> & file_path_cells = results["file_path"];
-                        std::vector<protocol::MySQLCell> & compare_results_cell = results["compare_results"];
-
-                        std::string user_name;
-                        std::string video_name;
-                        std::string file_path;
-                        std::string cover_path;
-                        int compare_results;
-
-                        std::stringstream keep_file_path_infos;
-                        std::stringstream remove_file_path_infos;
-                        for (int i = 0; i < (int)file_path_cells.size(); i++) {
-                            user_name = user_name_cells[i].as_string();
-                            video_name = video_name_cells[i].as_string();
-                            file_path = file_path_cells[i].as_string();
-                            compare_results = compare_results_cell[i].as_int();
-                            if (compare_results < 0) {
-                                char mysql_delete_query[512] = {0};
-                                std::snprintf(mysql_delete_query, sizeof(mysql_delete_query), 
-                                    "DELETE FROM glccserver.File WHERE username=\"%s\" AND video_name=\"%s\" AND file_path=\"%s\";", 
-                                    user_name.c_str(), video_name.c_str(), file_path.c_str());
-                                WFMySQLTask * mysql_delete_task = WFTaskFactory::create_mysql_task(
-                                    constants::mysql_glccserver_url, 0, 
-                                    [user_name, video_name, file_path](WFMySQLTask * task){
-                                        int state = task->get_state(); int error = task->get_error();
-                                        if (state == WFT_STATE_SUCCESS) {
-                                            LOG_F(INFO, "[SERVER][FILE_TIMER][%s][%s] DB delete %s success!", 
-                                                user_name.c_str(), video_name.c_str(), file_path.c_str());
-                                        } else {
-                                            LOG_F(ERROR, "[SERVER][FILE_TIMER][%s][%s] DB delete %s fail! Code: %d", 
-                                                user_name.c_str(), video_name.c_str(), file_path.c_str(), error);
-                                        }
-                                    }
-                                );
-                                mysql_delete_task->get_req()->set_query(mysql_delete_query);
-                                *series_of(task) << mysql_delete_task;
-                                if (check_file(file_path, nullptr, {}) < 0) {
-                                    LOG_F(WARNING, "[SERVER][FILE_TIMER][%s][%s] Can't find %s", 
-                                        user_name.c_str(), video_name.c_str(), file_path.c_str());
-                                } else {
-                                    int ret;
-                                    std::unordered_map<std::string, std::string> path_parse_results;
-                                    ret = parse_path(file_path, path_parse_results);
-                                    if (ret == -1) {
-                                        LOG_F(WARNING, "[SERVER][FILE_TIMER][%s][%s] Parse %s fail!", 
-                                            user_name.c_str(), video_name.c_str(), file_path.c_str());
-                                        return;
-                                    }
+    void GLCCServer::init_expiry() {
+        ExpiryService & expiry = ExpiryService::Instance();
+        expiry.set_loader(load_expiries);
+        expiry.set_handler(FILE_EXPIRY, expire_files);
+        expiry.set_handler(ROOM_EXPIRY, expire_rooms);
+    }
 
-                                    auto & stem = path_parse_results["stem"];
-                                    auto & dirname = path_parse_results["dirname"];
+    void GLCCServer::load_expiries(long long from_second, long long to_second) {
+        const std::vector<std::pair<std::string, int>> loads = {
+            {"load_file_expiries", FILE_EXPIRY}, {"load_room_expiries", ROOM_EXPIRY}
+        };
+        for (auto & load : loads) {
+            const int kind = load.second;
+            WFMySQLTask * mysql_task = StatementCache::Instance().create_task(
+                load.first, {from_second, to_second},
+                [kind, from_second](WFMySQLTask * task) {
+                    int state = task->get_state(); int error = task->get_error();
+                    std::vector<expiry_row_t> expiries;
+                    if (state == WFT_STATE_SUCCESS) {
+                        state = map_mysql_response(task, kind == FILE_EXPIRY ? file_expiry_mapper() : room_expiry_mapper(), expiries);
+                    }
+                    if (state != WFT_STATE_SUCCESS) {
+                        LOG_F(ERROR, "[SERVER][EXPIRY] Load expiries fail! Code: %d", error);
+                        ExpiryService::Instance().retry_load(from_second);
+                        return;
+                    }
+                    for (auto & expiry : expiries) {
+                        expiry_entry_t entry;
+                        entry.end_second = expiry.end_second;
+                        entry.kind = kind;
+                        entry.user_name = std::move(expiry.user_name);
+                        entry.video_name = std::move(expiry.video_name);
+                        entry.name = kind == FILE_EXPIRY ? std::move(expiry.file_path) : std::move(expiry.room_name);
+                        ExpiryService::Instance().push(std::move(entry));
+                    }
+                    LOG_F(INFO, "[SERVER][EXPIRY] Load %d %s expiries", (int)expiries.size(), 
+                        kind == FILE_EXPIRY ? "file" : "room");
+                }
+            );
+            if (mysql_task == nullptr) {
+                ExpiryService::Instance().retry_load(from_second);
+                continue;
+            }
+            mysql_task->start();
+        }
+    }
 
-                                    cover_path = dirname + "/" + stem + "." + constants::cover_save_suffix;
-                                    ret = remove(file_path.c_str());
-                                    if (ret == -1) {
-                                        LOG_F(WARNING, "[SERVER][FILE_TIMER][%s][%s] Delete %s fail!", 
-                                            user_name.c_str(), video_name.c_str(), file_path.c_str());
-                                    } else {
-                                        LOG_F(INFO, "[SERVER][FILE_TIMER][%s][%s] Delete %s success!", 
-                                            user_name.c_str(), video_name.c_str(), file_path.c_str());
-                                    }
+    void GLCCServer::expire_files(std::vector<expiry_entry_t> && files) {
+        sql_params_t params;
+        std::string rows;
+        for (auto & file : files) {
+            const std::string & user_name = file.user_name;
+            const std::string & video_name = file.video_name;
+            const std::string & file_path = file.name;
+            params.insert(params.end(), {user_name, video_name, file_path});
+            rows += rows.empty() ? "(?, ?, ?)" : ",(?, ?, ?)";
+
+            if (check_file(file_path, nullptr, {}) < 0) {
+                LOG_F(WARNING, "[SERVER][FILE_EXPIRY][%s][%s] Can't find %s", 
+                    user_name.c_str(), video_name.c_str(), file_path.c_str());
+                continue;
+            }
+            std::string cover_path;
+            if (get_cover_path(file_path, cover_path) == -1) {
+                LOG_F(WARNING, "[SERVER][FILE_EXPIRY][%s][%s] Parse %s fail!", 
+                    user_name.c_str(), video_name.c_str(), file_path.c_str());
+                continue;
+            }
+            for (auto & path : {file_path, cover_path}) {
+                if (remove(path.c_str()) == -1) {
+                    LOG_F(WARNING, "[SERVER][FILE_EXPIRY][%s][%s] Delete %s fail!", 
+                        user_name.c_str(), video_name.c_str(), path.c_str());
+                } else {
+                    LOG_F(INFO, "[SERVER][FILE_EXPIRY][%s][%s] Delete %s success!", 
+                        user_name.c_str(), video_name.c_str(), path.c_str());
+                }
+            }
+        }
 
-                                    ret = remove(cover_path.c_str());
-                                    if (ret == -1) {
-                                        LOG_F(WARNING, "[SERVER][FILE_TIMER][%s][%s] Delete %s fail!", 
-                                            user_name.c_str(), video_name.c_str(), cover_path.c_str());
-                                    } else {
-                                        LOG_F(INFO, "[SERVER][FILE_TIMER][%s][%s] Delete %s success!", 
-                                            user_name.c_str(), video_name.c_str(), cover_path.c_str());
-                                    }
-                                }
-                            } else {
-                            }
-                        }
-                    } else {
-                        LOG_F(INFO, "[SERVER][FILE_TIMER] Nothing to do");
-                    }
+        const int num_files = (int)files.size();
+        WFMySQLTask * mysql_delete_task = StatementCache::Instance().create_query_task(
+            "DELETE FROM glccserver.File WHERE (username, video_name, file_path) IN (" + rows + ")", params,
+            [num_files](WFMySQLTask * task) {
+                int state = task->get_state(); int error = task->get_error();
+                if (state == WFT_STATE_SUCCESS && parse_mysql_response(task) == WFT_STATE_SUCCESS) {
+                    LOG_F(INFO, "[SERVER][FILE_EXPIRY] DB delete %d files success!", num_files);
                 } else {
-                    LOG_F(ERROR, "[SERVER][FILE_TIMER] Timmer watch files fail! Code: %d", error);
+                    LOG_F(ERROR, "[SERVER][FILE_EXPIRY] DB delete %d files fail! Code: %d", num_files, error);
                 }
             }
         );
-        char mysql_query[256] = "select username, video_name, file_path, glccserver.func_time_compare(now(), end_time) as compare_results from glccserver.File";
-        mysql_task->get_req()->set_query(mysql_query);
-        *series << mysql_task;
-        *series << WFTaskFactory::create_timer_task(constants::interval_to_watch_file_second, file_timer_callback);
+        if (mysql_delete_task != nullptr) {
+            mysql_delete_task->start();
+        }
     }
 
-    void GLCCServer::detector_timer_callback(WFTimerTask * timer) {
-        SeriesWork * series = series_of(timer);
-        WFMySQLTask * mysql_task = WFTaskFactory::create_mysql_task(
-            constants::mysql_glccserver_url, 0, 
-            [](WFMySQLTask * task){
+    void GLCCServer::expire_rooms(std::vector<expiry_entry_t> && rooms) {
+        // a running detector deletes its row when it stops, the rows left behind are deleted here
+        sql_params_t params;
+        std::stringstream remove_room_name_infos;
+        std::stringstream find_detector_name_infos;
+        remove_room_name_infos << "[SERVER][ROOM_EXPIRY] Removing rooms: ";
+        find_detector_name_infos << "[SERVER][ROOM_EXPIRY] Find detectors: ";
+        for (auto & room : rooms) {
+            const std::string & room_name = room.name;
+            if (cancel_detector(room_name, WAKE_CANCEL) != WFT_STATE_NOREPLY) {
+                find_detector_name_infos << room_name << " ";
+            } else {
+                params.emplace_back(room_name);
+            }
+            remove_room_name_infos << room_name << " ";
+        }
+        LOG_F(INFO, remove_room_name_infos.str().c_str());
+        LOG_F(INFO, find_detector_name_infos.str().c_str());
+        if (params.empty()) {
+            return;
+        }
+
+        const int num_rooms = (int)params.size();
+        WFMySQLTask * mysql_delete_task = StatementCache::Instance().create_query_task(
+            "DELETE FROM glccserver.Room WHERE room_name IN (" + sql_placeholders(params.size()) + ")", params,
+            [num_rooms](WFMySQLTask * task) {
                 int state = task->get_state(); int error = task->get_error();
-                if (state == WFT_STATE_SUCCESS) {
-                    std::unordered_map<std::string, std::vector<protocol::MySQLCell>> results;
-                    parse_mysql_response(task, results);
-                    if (results.size() > 0) {
-                        std::vector<protocol::MySQLCell> & room_name_cells = results["room_name"];
-                        std::vector<protocol::MySQLCell> & compare_results_cell = results["compare_results"];
-                        std::string room_name;
-                        int compare_results;
-                        std::stringstream mysql_delete_query;
-                        std::stringstream keep_room_name_infos;
-                        std::stringstream remove_room_name_infos;
-                        std::stringstream find_detector_name_infos;
-                        keep_room_name_infos << "[SERVER][DETECTOR] Keeping rooms: ";
-                        remove_room_name_infos << "[SERVER][DETECTOR] Removing rooms: ";
-                        find_detector_name_infos << "[SERVER][DETECTOR] Find detectors: ";
-                        for (int i = 0; i < (int)room_name_cells.size(); i++) {
-                            room_name = room_name_cells[i].as_string();
-                            compare_results = compare_results_cell[i].as_int();
-                            if (compare_results < 0) {
-                                int ret = cancel_detector(room_name, WAKE_CANCEL);
-                                if (ret != WFT_STATE_NOREPLY) {
-                                    find_detector_name_infos << room_name << " ";
-                                }
-                                remove_room_name_infos << room_name << " ";
-                            } else {
-                                keep_room_name_infos << room_name << " ";
-                            }
-                        }
-                        LOG_F(INFO, keep_room_name_infos.str().c_str());
-                        LOG_F(INFO, remove_room_name_infos.str().c_str());
-                        LOG_F(INFO, find_detector_name_infos.str().c_str());
-                    } else {
-                        LOG_F(INFO, "[SERVER][DETECTOR] Nothing to watch");
-                    }
+                if (state == WFT_STATE_SUCCESS && parse_mysql_response(task) == WFT_STATE_SUCCESS) {
+                    LOG_F(INFO, "[SERVER][ROOM_EXPIRY] DB delete %d rooms success!", num_rooms);
                 } else {
-                    LOG_F(ERROR, "[SERVER][DETECTOR] Timmer watch detectors fail! Code: %d", error);
+                    LOG_F(ERROR, "[SERVER][ROOM_EXPIRY] DB delete %d rooms fail! Code: %d", num_rooms, error);
                 }
             }
         );
-        char mysql_query[256] = "select room_name, glccserver.func_time_compare(now(), end_time) as compare_results from glccserver.Room";
-        mysql_task->get_req()->set_query(mysql_query);
-        *series << mysql_task;
-        *series << WFTaskFactory::create_timer_task(constants::interval_to_watch_detector_second, detector_timer_callback);
+        if (mysql_delete_task != nullptr) {
+            mysql_delete_task->start();
+        }
     }
 
     void GLCCServer::run_detector(const std::string & room_name, std::shared_ptr<glcc_server_context_t> context) {
@@ -1764,7 +2012,7 @@ namespace GLCC {
         std::string user_name = context->extra_info["user_name"].asString();
         auto & user_dir = context->server_dir.user_dir;
         std::string video_dir = user_dir + "/" + video_name;
-        Detector * detector = register_detector(room_name, context, Create_Register);
+        std::shared_ptr<Detector> detector = register_detector(room_name, context, Create_Register);
         if (context->state == WFT_STATE_TASK_ERROR) {
             LOG_F(ERROR, "[SERVER][RUN_DETECTOR][%s][%s][%s] Register Detector fail!", 
                 user_name.c_str(),video_name.c_str(), room_name.c_str());
@@ -1774,35 +2022,35 @@ namespace GLCC {
                 user_name.c_str(), video_name.c_str(), room_name.c_str(), mode.c_str());
             detector->resource_dir = video_dir;
             detector_run_context.vis_params = detector_init_context[(const char *)mode.c_str()]["extra_config"];
-            detector->state = 1;
-            WFMySQLTask * mysql_task = WFTaskFactory::create_mysql_task(
-                constants::mysql_glccserver_url, 0,
+            if (!detector->lifecycle.start()) {
+                LOG_F(INFO, "[SERVER][RUN_DETECTOR][%s][%s][%s] Cancelled before run!", 
+                    user_name.c_str(), video_name.c_str(), room_name.c_str());
+                cancel_detector(room_name, FORCE_CANCEL);
+                context->state = WFT_STATE_TASK_ERROR;
+                return;
+            }
+            WFMySQLTask * mysql_task = StatementCache::Instance().create_task(
+                "fetch_contours", {video_name, user_name},
                 [detector, room_name](WFMySQLTask * task) {
                     int state = task->get_state(); int error = task->get_error();
                     if (state == WFT_STATE_SUCCESS) {
-                        std::unordered_map<std::string, std::vector<protocol::MySQLCell>> results;
-                         parse_mysql_response(task, results);
-                        if (results.size() > 0) {
-                            if (results.find("contour_name") != results.end()) {
-                                std::vector<protocol::MySQLCell> & contour_name = results["contour_name"];
-                                std::vector<protocol::MySQLCell> & contour_path = results["contour_path"];
-                                Json::Reader reader; Json::Value value;
-                                for (int i = 0; i < (int)contour_name.size(); i++) {
-                                    value.clear();
-                                    std::string contour_name_str = contour_name[i].as_string();
-                                    std::string contour_path_str = contour_path[i].as_string();
-                                    reader.parse(contour_path_str, value);
-                                    std::vector<cv::Point2i> points_list;
-                                    for (int i = 0; i < (int)value.size() / 2; i++) {
-                                        points_list.emplace_back(
-                                            value[i * 2].asInt(), value[i * 2 + 1].asInt()
-                                        );
-                                    }
-                                    detector->contour_list[contour_name_str] = points_list;
+                        std::vector<contour_row_t> contours;
+                        map_mysql_response(task, contour_mapper(), contours);
+                        if (contours.size() > 0) {
+                            Json::Reader reader; Json::Value value;
+                            contour_list_t contour_list;
+                            for (auto & contour : contours) {
+                                value.clear();
+                                reader.parse(contour.contour_path, value);
+                                std::vector<cv::Point2i> & points_list = contour_list[contour.contour_name];
+                                for (int i = 0; i < (int)value.size() / 2; i++) {
+                                    points_list.emplace_back(
+                                        value[i * 2].asInt(), value[i * 2 + 1].asInt()
+                                    );
                                 }
-                            } else {
-                                LOG_F(INFO, "[SERVER][DECT][CONTOUR] Find the contour of %s fail!", room_name.c_str());
                             }
+                            // published as one snapshot, the runner never sees half of them
+                            detector->set_contours(contour_list);
                         } else {
                             LOG_F(INFO, "[SERVER][DECT][CONTOUR] Find the contour of %s fail!", room_name.c_str());
                         }
@@ -1811,48 +2059,30 @@ namespace GLCC {
                     }
                 }
             );
-
-            char mysql_query[512];
-            std::snprintf(mysql_query, sizeof(mysql_query),
-                "SELECT contour_name, contour_path FROM glccserver.Contour "
-                "WHERE video_name=\"%s\" AND username=\"%s\";", video_name.c_str(), user_name.c_str());
-            mysql_task->get_req()->set_query(mysql_query);
-            mysql_task->start();
+            if (mysql_task != nullptr) {
+                mysql_task->start();
+            }
 
             auto deal_func = [video_name, user_name] (void * args) {
                 std::string video_file_path = (*(std::stringstream *)args).str();
-                char mysql_query[1024];
-                std::snprintf(mysql_query, sizeof(mysql_query),
-                    "INSERT INTO glccserver.File(file_path, video_name, username, start_time, end_time) VALUES "
-                    "(\"%s\", \"%s\", \"%s\", now(), date_add(now(), interval %ld DAY));",
-                    video_file_path.c_str(), video_name.c_str(), user_name.c_str(), constants::max_video_file_save_day);
-                WFMySQLTask * mysql_task = WFTaskFactory::create_mysql_task(
-                    constants::mysql_glccserver_url, 0, 
-                    [video_file_path, video_name, user_name](WFMySQLTask * task) {
-                        int state = task->get_state(); int error = task->get_error();
-                        if (state == WFT_STATE_SUCCESS) {
-                            int parse_state = parse_mysql_response(task);
-                            if (parse_state == WFT_STATE_SUCCESS) {
-                                LOG_F(INFO, "[SERVER][DETECTOR][VIDEO_POST_PROCESS][%s][%s] Insert %s success!", 
-                                    user_name.c_str(), video_name.c_str(), video_file_path.c_str());
-                            } else {
-                                LOG_F(ERROR, "[SERVER][DETECTOR][VIDEO_POST_PROCESS][%s][%s] Insert %s fail!",  
-                                    user_name.c_str(), video_name.c_str(), video_file_path.c_str());
-                            }
-                        } else {
-                            LOG_F(ERROR, "[SERVER][DETECTOR][VIDEO_POST_PROCESS][%s][%s] Insert %s fail! Code: %d", 
-                                user_name.c_str(), video_name.c_str(), video_file_path.c_str(), error);
-                        }
-                    }
-                );
-                mysql_task->get_req()->set_query(mysql_query);
-                mysql_task->start();
+                WriteBehind::Instance().push("insert_file",
+                    {video_file_path, video_name, user_name, constants::max_video_file_save_day},
+                    "[" + user_name + "][" + video_name + "] " + video_file_path);
+                expiry_entry_t expiry;
+                expiry.end_second = time(nullptr) + constants::max_video_file_save_day * constants::num_second_per_day;
+                expiry.kind = FILE_EXPIRY;
+                expiry.user_name = user_name;
+                expiry.video_name = video_name;
+                expiry.name = video_file_path;
+                ExpiryService::Instance().push(std::move(expiry));
             };
 
             int ret = detector->run(&detector_run_context, 
-                [&room_name](void * args){
-                    cancel_detector(room_name, FORCE_CANCEL);
+                [detector](void * args){
+                    detector->lifecycle.cancel();
                 }, deal_func);
+            // the runner has exited, release the room and mark it stopped for the joiners
+            cancel_detector(room_name, FORCE_CANCEL);
             if (ret == -1) {
                 LOG_F(INFO, "[SERVER][RUN_DETECTOR][%s][%s][%s] Run stop!", 
                     user_name.c_str(), video_name.c_str(), room_name.c_str());
@@ -1864,8 +2094,8 @@ namespace GLCC {
         }
     }
 
-    Detector * GLCCServer::register_detector(const std::string & room_name, std::shared_ptr<glcc_server_context_t> context, int mode) {
-        Detector * detector;
+    std::shared_ptr<Detector> GLCCServer::register_detector(const std::string & room_name, std::shared_ptr<glcc_server_context_t> context, int mode) {
+        std::shared_ptr<Detector> detector;
         Json::Value extra_info = context->extra_info;
         std::string user_name = extra_info["user_name"].asString();
         std::string video_name = context->video_context.video_name;
@@ -1875,16 +2105,29 @@ namespace GLCC {
         mode_context["resource_dir"] = mode_context["resource_dir"].asString() + "-" + room_name;
         detector = ProductFactory<Detector>::Instance().GetProduct(room_name);
         if (mode == Create_Register) {
+            if (detector != nullptr && detector->lifecycle.is_cancelled()) {
+                // a stop-then-restart, wait for the old runner to leave its last frame and release the room
+                if (!detector->lifecycle.join(detector_join_millisecond)) {
+                    LOG_F(ERROR, "[SERVER][REGISTER_DETECTOR][%s][%s][%s] The stopping detector doesn't exit!", 
+                        user_name.c_str(), video_name.c_str(), room_name.c_str());
+                    context->state = WFT_STATE_TASK_ERROR;
+                    return nullptr;
+                }
+                ProductFactory<Detector>::Instance().EraseProduct(room_name, detector);
+                detector = nullptr;
+            }
             if (detector == nullptr) {
-                register_map(detector_mode, room_name, &mode_context);
-                detector = ProductFactory<Detector>::Instance().GetProduct(room_name);
+                // another request may create the room first, only the creator runs it
+                bool is_created = false;
+                detector = register_map(detector_mode, room_name, &mode_context, &is_created);
+                if (detector != nullptr && !is_created) {
+                    context->state = WFT_STATE_TOREPLY;
+                }
             } else {
                 context->state = WFT_STATE_TOREPLY;
             }
 
-            if (detector->state == -1) {
-                detector = nullptr;
-                cancel_detector(room_name, NORMAL_CANCEL);
+            if (detector == nullptr) {
                 context->state = WFT_STATE_TASK_ERROR;
             } else{
                 if (context->state != WFT_STATE_TOREPLY) {
@@ -1892,106 +2135,75 @@ namespace GLCC {
                 }
             }
         } else if (mode == Judge_Register) {
-            if (detector == nullptr) {
-                return detector;
+            // a stopping detector is replaced by the run task, which joins it first
+            if (detector == nullptr || detector->lifecycle.is_cancelled()) {
+                return nullptr;
             } else {
                 context->state = WFT_STATE_TOREPLY;
             }
         }
 
         if (context->state == WFT_STATE_SUCCESS) {
-            WFMySQLTask * mysql_task = WFTaskFactory::create_mysql_task(
-                constants::mysql_glccserver_url, 0, 
-                [user_name, video_name, room_name](WFMySQLTask * task) {
-                    int state = task->get_state();int error = task->get_error();
-                    if (state == WFT_STATE_SUCCESS) {
-                        int parse_state = parse_mysql_response(task);
-                        if (parse_state == WFT_STATE_SUCCESS) {
-                            LOG_F(INFO, "[SERVER][REGISTER_DETECTOR][%s][%s] Create the room: %s success!", 
-                                user_name.c_str(), video_name.c_str(), room_name.c_str());
-                        } else {
-                            LOG_F(INFO, "[SERVER][REGISTER_DETECTOR][%s][%s] Create the room: %s fail!", 
-                                user_name.c_str(), video_name.c_str(), room_name.c_str());
-                        }
-                    } else {
-                        LOG_F(ERROR, "[SERVER][REGISTER_DETECTOR][%s][%s] Create the room: %s fail! Code: %d", 
-                            user_name.c_str(), video_name.c_str(), room_name.c_str(), error);
-                    }
-                }
-            );
-            char mysql_query[512];
-            std::snprintf(mysql_query, sizeof(mysql_query), 
-                "INSERT INTO glccserver.Room(room_name, username, video_name, start_time, end_time)"
-                "VALUES(\"%s\", \"%s\", \"%s\", now(), date_add(now(), interval %ld DAY));", 
-                   room_name.c_str(), user_name.c_str(), video_name.c_str(), constants::max_detector_live_day);
-            mysql_task->get_req()->set_query(mysql_query);
-            mysql_task->start();
+            WriteBehind::Instance().push("insert_room",
+                {room_name, user_name, video_name, constants::max_detector_live_day},
+                "[" + user_name + "][" + video_name + "] " + room_name);
         } else if (context->state == WFT_STATE_TOREPLY) {
-            WFMySQLTask * mysql_task = WFTaskFactory::create_mysql_task(
-                constants::mysql_glccserver_url, 0, 
-                [user_name, video_name, room_name](WFMySQLTask * task) {
-                    int state = task->get_state(); int error = task->get_error();
-                    if (state == WFT_STATE_SUCCESS) {
-                        std::unordered_map<std::string, std::vector<protocol::MySQLCell>> results;
-                        int parse_state = parse_mysql_response(task, results);
-                        if (parse_state == WFT_STATE_SUCCESS){
-                            LOG_F(INFO, "[SERVER][REGISTER_DETECTOR][%s][%s][%s] DB update time success!", 
-                                user_name.c_str(), video_name.c_str(), room_name.c_str());
-                        } else {
-                            LOG_F(INFO, "[SERVER][REGISTER_DETECTOR][%s][%s][%s] DB update time fail!",
-                                user_name.c_str(), video_name.c_str(), room_name.c_str());
-                        }
-                    } else {
-                        LOG_F(INFO, "[SERVER][REGISTER_DETECTOR][%s][%s][%s] DB update time fail! Code: %d", 
-                            user_name.c_str(), video_name.c_str(), room_name.c_str(), error);
-                    }
-                }
-            );
-
-            char mysql_query[512];
-            std::snprintf(mysql_query, sizeof(mysql_query), 
-                "UPDATE glccserver.Room SET start_time=now(), end_time=date_add(now(), INTERVAL %ld MICROSECOND) "
-                "WHERE room_name=\"%s\";", constants::max_detector_live_day, room_name.c_str());
-            mysql_task->get_req()->set_query(mysql_query);
-            mysql_task->start();
+            WriteBehind::Instance().push("update_room", {room_name},
+                "[" + user_name + "][" + video_name + "] " + room_name);
+        }
+        if (context->state == WFT_STATE_SUCCESS || context->state == WFT_STATE_TOREPLY) {
+            expiry_entry_t expiry;
+            expiry.end_second = time(nullptr) + constants::max_detector_live_day * constants::num_second_per_day;
+            expiry.kind = ROOM_EXPIRY;
+            expiry.user_name = user_name;
+            expiry.video_name = video_name;
+            expiry.name = room_name;
+            ExpiryService::Instance().push(std::move(expiry));
         }
         return detector;
     }
 
-    void GLCCServer::register_map(const std::string & mode, const std::string & room_name, void * context) {
+    std::shared_ptr<Detector> GLCCServer::register_map(const std::string & mode, const std::string & room_name, 
+                                                       void * context, bool * is_created) {
         if (mode == "ObjectDetector") {
-            ProductFactory<Detector>::Instance().RegisterProduct(room_name, ObjectDetector::init_func, context);
+            return ProductFactory<Detector>::Instance().RegisterProduct(room_name, ObjectDetector::init_func, context, is_created);
         } else if (mode == "TrackerDetector") {
-            ProductFactory<Detector>::Instance().RegisterProduct(room_name, TrackerDetector::init_func, context);
+            return ProductFactory<Detector>::Instance().RegisterProduct(room_name, TrackerDetector::init_func, context, is_created);
         }
+        LOG_F(ERROR, "[SERVER][REGISTER_MAP][%s] Unknown detector mode: %s", room_name.c_str(), mode.c_str());
+        return nullptr;
     };
 
     int GLCCServer::cancel_detector(const std::string & room_name, int mode) {
         int state;
-        Detector * detector = ProductFactory<Detector>::Instance().GetProduct(room_name);
+        if (mode == FORCE_CANCEL || mode == WAKE_CANCEL) {
+            // a queued room has no detector yet, it only has to leave the queue
+            RoomScheduler::Instance().cancel(room_name);
+        }
+        std::shared_ptr<Detector> detector = ProductFactory<Detector>::Instance().GetProduct(room_name);
         if (detector == nullptr) {
             state = WFT_STATE_NOREPLY;
         } else {
             state = WFT_STATE_SUCCESS;
             if (mode == FORCE_CANCEL || mode == WAKE_CANCEL) {
                 if (mode == FORCE_CANCEL) {
-                    detector->state = -1;
+                    // called by the runner once run() returned. The room is released once its row is deleted,
+                    // a restart joins it first, so its insert_room never races the delete. The livego kick
+                    // runs beside it and doesn't hold the restart.
+                    detector->lifecycle.cancel();
+                    auto release_func = [room_name, detector]() {
+                        int ret = ProductFactory<Detector>::Instance().EraseProduct(room_name, detector);
+                        if (ret != 1) {
+                            LOG_F(INFO, "[SERVER][CANCEL_DETECTOR][%s] Erase product fail! Code: %d", room_name.c_str(), ret);
+                        } else {
+                            LOG_F(INFO, "[SERVER][CANCEL_DETECTOR][%s] Erase product %d", room_name.c_str(), ret);
+                        }
+                        detector->lifecycle.finish();
+                    };
 
                     char livego_check_stat_url[256] = {0};
                     std::snprintf(livego_check_stat_url, sizeof(livego_check_stat_url), 
                         constants::livego_check_stat_template.c_str(), room_name.c_str());
-                    WFGraphTask * graph_task = WFTaskFactory::create_graph_task(
-                        [room_name](WFGraphTask * task) {
-                            int ret = ProductFactory<Detector>::Instance().EraseProductDel(room_name);
-                            if (ret != 1) {
-                                LOG_F(INFO, "[SERVER][CANCEL_DETECTOR][%s] Erase product fail! Code: %d", room_name.c_str(), ret);
-                            } else {
-                                LOG_F(INFO, "[SERVER][CANCEL_DETECTOR][%s] Erase product %d", room_name.c_str(), ret);
-                            }
-                            LOG_F(INFO, "[SERVER][CANCEL_DETECTOR][%s] Release Dect graph task complete!", room_name.c_str());
-                        }
-                    );
-
                     WFHttpTask * check_stat_http_task = WFTaskFactory::create_http_task(
                         livego_check_stat_url, 0, 0,
                         [room_name](WFHttpTask * task) {
@@ -2049,9 +2261,9 @@ namespace GLCC {
                     // set_common_resp()
                     set_common_req(check_stat_http_task->get_req());
 
-                    WFMySQLTask * delete_sql_task = WFTaskFactory::create_mysql_task(
-                        constants::mysql_glccserver_url, 0, 
-                        [room_name](WFMySQLTask * task) {
+                    WFMySQLTask * delete_sql_task = StatementCache::Instance().create_task(
+                        "delete_room", {room_name},
+                        [room_name, release_func](WFMySQLTask * task) {
                             int state = task->get_state(); int error = task->get_error();
                             if (state == WFT_STATE_SUCCESS) {
                                 int parse_state = parse_mysql_response(task);
@@ -2063,30 +2275,25 @@ namespace GLCC {
                             } else {
                                 LOG_F(INFO, "[SERVER][CANCEL_DETECTOR][%s] DB delete room fail! Code: %d", room_name.c_str(), error);
                             }
+                            release_func();
                         }
                     );
-
-
-                    char mysql_query[128];
-                    std::snprintf(mysql_query, sizeof(mysql_query), 
-                        "delete from glccserver.Room where room_name=\"%s\"", room_name.c_str());
-                    delete_sql_task->get_req()->set_query(mysql_query);
-                    WFGraphNode & node1 = graph_task->create_graph_node(check_stat_http_task);
-                    WFGraphNode & node2 = graph_task->create_graph_node(delete_sql_task);
-                    node1-->node2;
-                    graph_task->start();
-                } else if (mode == WAKE_CANCEL && detector->state > 0) {
-                    detector->state = -1;
+                    if (delete_sql_task != nullptr) {
+                        delete_sql_task->start();
+                    } else {
+                        release_func();
+                    }
+                    check_stat_http_task->start();
+                } else if (mode == WAKE_CANCEL) {
+                    detector->lifecycle.cancel();
                 } else {
                     LOG_F(ERROR, "[SERVER][CANCEL_DETECTOR][%s] Can't find cancel mode: %d", room_name.c_str(), mode);
                 }
-            } else if (mode == NORMAL_CANCEL && detector->state == 0) {
-                detector->state = -1;
-                ProductFactory<Detector>::Instance().EraseProductDel(room_name);
+            } else if (mode == NORMAL_CANCEL && detector->lifecycle.get_state() == LIFECYCLE_STARTING) {
+                detector->lifecycle.cancel();
+                ProductFactory<Detector>::Instance().EraseProduct(room_name, detector);
+                detector->lifecycle.finish();
                 LOG_F(INFO, "[SERVER][CANCEL_DETECTOR][%s] Delete the unrun detector", room_name.c_str());
-            } else if (mode == NORMAL_CANCEL && detector->state == -1) {
-                ProductFactory<Detector>::Instance().EraseProductDel(room_name);
-                LOG_F(INFO, "[SERVER][CANCEL_DETECTOR][%s] Delete the bad detector", room_name.c_str());
             }
         }
         return state;
@@ -2116,265 +2323,29 @@ namespace GLCC {
     }
 
     int GLCCServer::parse_mysql_response(WFMySQLTask * task) {
-        protocol::MySQLResponse *resp = task->get_resp();
-        protocol::MySQLResultCursor cursor(resp);
-        const protocol::MySQLField * const * fields;
-        std::vector<protocol::MySQLCell> arr;
-        do {
-            if (cursor.get_cursor_status() != MYSQL_STATUS_GET_RESULT &&
-                cursor.get_cursor_status() != MYSQL_STATUS_OK)
-            {
-                break;
-            }
-
-            LOG_F(1, "---------------- RESULT SET ----------------\n");
-
-            if (cursor.get_cursor_status() == MYSQL_STATUS_GET_RESULT)
-            {
-                LOG_F(1, "cursor_status=%d field_count=%u rows_count=%u\n",
-                        cursor.get_cursor_status(), cursor.get_field_count(),
-                        cursor.get_rows_count());
-
-                //nocopy api
-                fields = cursor.fetch_fields();
-                for (int i = 0; i < cursor.get_field_count(); i++)
-                {
-                    if (i == 0)
-                    {
-                        LOG_F(1, "db=%s table=%s\n",
-                            fields[i]->get_db().c_str(), fields[i]->get_table().c_str());
-                        LOG_F(1, "  ---------- COLUMNS ----------\n");
-                    }
-                    LOG_F(1, "  name[%s] type[%s]\n",
-                            fields[i]->get_name().c_str(),
-                            datatype2str(fields[i]->get_data_type()));
-                }
-                LOG_F(1, "  _________ COLUMNS END _________\n\n");
-
-                while (cursor.fetch_row(arr))
-                {
-                    LOG_F(1, "  ------------ ROW ------------\n");
-                    for (size_t i = 0; i < arr.size(); i++)
-                    {
-                        LOG_F(1, "  [%s][%s]", fields[i]->get_name().c_str(),
-                                datatype2str(arr[i].get_data_type()));
-                        if (arr[i].is_string())
-                        {
-                            std::string res = arr[i].as_string();
-                            if (res.length() == 0)
-                                LOG_F(1, "[\"\"]\n");
-                            else 
-                                LOG_F(1, "[%s]\n", res.c_str());
-                        } else if (arr[i].is_int()) {
-                            LOG_F(1, "[%d]\n", arr[i].as_int());
-                        } else if (arr[i].is_ulonglong()) {
-                            LOG_F(1, "[%llu]\n", arr[i].as_ulonglong());
-                        } else if (arr[i].is_float()) {
-                            const void *ptr;
-                            size_t len;
-                            int data_type;
-                            arr[i].get_cell_nocopy(&ptr, &len, &data_type);
-                            size_t pos;
-                            for (pos = 0; pos < len; pos++)
-                                if (*((const char *)ptr + pos) == '.')
-                                    break;
-                            if (pos != len)
-                                pos = len - pos - 1;
-                            else
-                                pos = 0;
-                            LOG_F(1, "[%.*f]\n", (int)pos, arr[i].as_float());
-                        } else if (arr[i].is_double()) {
-                            const void *ptr;
-                            size_t len;
-                            int data_type;
-                            arr[i].get_cell_nocopy(&ptr, &len, &data_type);
-                            size_t pos;
-                            for (pos = 0; pos < len; pos++)
-                                if (*((const char *)ptr + pos) == '.')
-                                    break;
-                            if (pos != len)
-                                pos = len - pos - 1;
-                            else
-                                pos= 0;
-                            LOG_F(1, "[%.*lf]\n", (int)pos, arr[i].as_double());
-                        } else if (arr[i].is_date()) {
-                            LOG_F(1, "[%s]\n", arr[i].as_string().c_str());
-                        } else if (arr[i].is_time()) {
-                            LOG_F(1, "[%s]\n", arr[i].as_string().c_str());
-                        } else if (arr[i].is_datetime()) {
-                            LOG_F(1, "[%s]\n", arr[i].as_string().c_str());
-                        } else if (arr[i].is_null()) {
-                            LOG_F(1, "[NULL]\n");
-                        } else {
-                            std::string res = arr[i].as_binary_string();
-                            if (res.length() == 0)
-                                LOG_F(1, "[\"\"]\n");
-                            else 
-                                LOG_F(1, "[%s]\n", res.c_str());
-                        }
+        protocol::MySQLResponse * resp = task->get_resp();
+        // the dumps format every cell, skip walking the result sets unless verbosity 1 is on
+        if (is_mysql_dump()) {
+            protocol::MySQLResultCursor cursor(resp);
+            std::vector<protocol::MySQLCell> arr;
+            do {
+                if (cursor.get_cursor_status() == MYSQL_STATUS_GET_RESULT) {
+                    dump_mysql_fields(cursor);
+                    const protocol::MySQLField * const * fields = cursor.fetch_fields();
+                    while (cursor.fetch_row(arr)) {
+                        dump_mysql_row(fields, arr);
                     }
-                    LOG_F(1, "  __________ ROW END __________\n");
+                } else if (cursor.get_cursor_status() != MYSQL_STATUS_OK) {
+                    break;
                 }
-            }
-            else if (cursor.get_cursor_status() == MYSQL_STATUS_OK)
-            {
-                LOG_F(1, "  OK. %llu ", cursor.get_affected_rows());
-                if (cursor.get_affected_rows() == 1)
-                    LOG_F(1, "row ");
-                else
-                    LOG_F(1, "rows ");
-                LOG_F(1, "affected. %d warnings. insert_id=%llu. %s\n",
-                        cursor.get_warnings(), cursor.get_insert_id(),
-                        cursor.get_info().c_str());
-            }
-
-            LOG_F(1, "________________ RESULT SET END ________________\n\n");
-        } while (cursor.next_result_set());
-
-
-        if (resp->get_packet_type() == MYSQL_PACKET_ERROR)
-        {
-            LOG_F(ERROR, "Error_code=%d %s\n",
-                    task->get_resp()->get_error_code(),
-                    task->get_resp()->get_error_msg().c_str());
-            return WFT_STATE_TASK_ERROR;
-        }
-        else if (resp->get_packet_type() == MYSQL_PACKET_OK) // just check origin APIs
-        {
-            LOG_F(1, "OK. %llu ", task->get_resp()->get_affected_rows());
-            if (task->get_resp()->get_affected_rows() == 1)
-                LOG_F(1, "row ");
-            else
-                LOG_F(1, "rows ");
-            LOG_F(1, "affected. %d warnings. insert_id=%llu. %s\n",
-                    task->get_resp()->get_warnings(),
-                    task->get_resp()->get_last_insert_id(),
-                    task->get_resp()->get_info().c_str());
+            } while (cursor.next_result_set());
+            dump_mysql_status(resp);
         }
 
-        return WFT_STATE_SUCCESS;
-    }
-
-    int GLCCServer::parse_mysql_response(WFMySQLTask * task, std::unordered_map<std::string, std::vector<protocol::MySQLCell>> & results) {
-        protocol::MySQLResponse *resp = task->get_resp();
-        protocol::MySQLResultCursor cursor(resp);
-        const protocol::MySQLField * const * fields;
-        std::vector<protocol::MySQLCell> arr;
-        do {
-            if (cursor.get_cursor_status() != MYSQL_STATUS_GET_RESULT) {
-                break;
-            }
-
-            LOG_F(1, "---------------- RESULT SET ----------------\n");
-
-            LOG_F(1, "cursor_status=%d field_count=%u rows_count=%u\n",
-                    cursor.get_cursor_status(), cursor.get_field_count(),
-                    cursor.get_rows_count());
-
-            //nocopy api
-            fields = cursor.fetch_fields();
-            for (int i = 0; i < cursor.get_field_count(); i++) {
-                if (i == 0)
-                {
-                    LOG_F(1, "db=%s table=%s\n",
-                        fields[i]->get_db().c_str(), fields[i]->get_table().c_str());
-                    LOG_F(1, "  ---------- COLUMNS ----------\n");
-                }
-                LOG_F(1, "  name[%s] type[%s]\n",
-                        fields[i]->get_name().c_str(),
-                        datatype2str(fields[i]->get_data_type()));
-            }
-            LOG_F(1, "  _________ COLUMNS END _________\n\n");
-
-            while (cursor.fetch_row(arr)) {
-                LOG_F(1, "  ------------ ROW ------------\n");
-                for (size_t i = 0; i < arr.size(); i++)
-                {
-                    std::string column_name = fields[i]->get_name();
-                    LOG_F(1, "  [%s][%s]",  column_name.c_str(),
-                            datatype2str(arr[i].get_data_type()));
-                    if (arr[i].is_string())
-                    {
-                        std::string res = arr[i].as_string();
-                        if (res.length() == 0)
-                            LOG_F(1, "[\"\"]\n");
-                        else 
-                            LOG_F(1, "[%s]\n", res.c_str());
-                    } else if (arr[i].is_int()) {
-                        LOG_F(1, "[%d]\n", arr[i].as_int());
-                    } else if (arr[i].is_ulonglong()) {
-                        LOG_F(1, "[%llu]\n", arr[i].as_ulonglong());
-                    } else if (arr[i].is_float()) {
-                        const void *ptr;
-                        size_t len;
-                        int data_type;
-                        arr[i].get_cell_nocopy(&ptr, &len, &data_type);
-                        size_t pos;
-                        for (pos = 0; pos < len; pos++)
-                            if (*((const char *)ptr + pos) == '.')
-                                break;
-                        if (pos != len)
-                            pos = len - pos - 1;
-                        else
-                            pos = 0;
-                        LOG_F(1, "[%.*f]\n", (int)pos, arr[i].as_float());
-                    } else if (arr[i].is_double()) {
-                        const void *ptr;
-                        size_t len;
-                        int data_type;
-                        arr[i].get_cell_nocopy(&ptr, &len, &data_type);
-                        size_t pos;
-                        for (pos = 0; pos < len; pos++)
-                            if (*((const char *)ptr + pos) == '.')
-                                break;
-                        if (pos != len)
-                            pos = len - pos - 1;
-                        else
-                            pos= 0;
-                        LOG_F(1, "[%.*lf]\n", (int)pos, arr[i].as_double());
-                    } else if (arr[i].is_date()) {
-                        LOG_F(1, "[%s]\n", arr[i].as_string().c_str());
-                    } else if (arr[i].is_time()) {
-                        LOG_F(1, "[%s]\n", arr[i].as_string().c_str());
-                    } else if (arr[i].is_datetime()) {
-                        LOG_F(1, "[%s]\n", arr[i].as_string().c_str());
-                    } else if (arr[i].is_null()) {
-                        LOG_F(1, "[NULL]\n");
-                    } else {
-                        std::string res = arr[i].as_binary_string();
-                        if (res.length() == 0)
-                            LOG_F(1, "[\"\"]\n");
-                        else 
-                            LOG_F(1, "[%s]\n", res.c_str());
-                    }
-                    results[column_name].emplace_back(std::move(arr[i]));
-                }
-                LOG_F(1, "  __________ ROW END __________\n");
-            }
-            LOG_F(1, "________________ RESULT SET END ________________\n\n");
-        } while (cursor.next_result_set());
-
-
-        if (resp->get_packet_type() == MYSQL_PACKET_ERROR)
-        {
-            LOG_F(1, "ERROR. error_code=%d %s\n",
-                    task->get_resp()->get_error_code(),
-                    task->get_resp()->get_error_msg().c_str());
+        if (resp->get_packet_type() == MYSQL_PACKET_ERROR) {
+            LOG_F(ERROR, "Error_code=%d %s", resp->get_error_code(), resp->get_error_msg().c_str());
             return WFT_STATE_TASK_ERROR;
         }
-        else if (resp->get_packet_type() == MYSQL_PACKET_OK) // just check origin APIs
-        {
-            LOG_F(1, "OK. %llu ", task->get_resp()->get_affected_rows());
-            if (task->get_resp()->get_affected_rows() == 1)
-                LOG_F(1, "row ");
-            else
-                LOG_F(1, "rows ");
-            LOG_F(1, "affected. %d warnings. insert_id=%llu. %s\n",
-                    task->get_resp()->get_warnings(),
-                    task->get_resp()->get_last_insert_id(),
-                    task->get_resp()->get_info().c_str());
-        }
-
         return WFT_STATE_SUCCESS;
     }
 }
@@ -0,0 +1,106 @@
+#include "session.h"
+
+namespace GLCC {
+    SessionTable::SessionTable(const int num_shards, const long max_sessions, const long ttl_second):
+            max_shard_sessions(std::max(max_sessions / std::max(num_shards, 1), 1L)),
+            ttl(ttl_second > 0 ? ttl_second : 3600) {
+        for (int i = 0; i < std::max(num_shards, 1); i++) {
+            shards.emplace_back(new shard_t);
+        }
+    }
+
+    SessionTable::shard_t & SessionTable::get_shard(const std::string & token) {
+        return *shards[std::hash<std::string>()(token) % shards.size()];
+    }
+
+    std::string SessionTable::make_token() {
+        // 128 bits from the kernel csprng, a token can't be predicted from the ones handed out before
+        unsigned char bytes[16];
+        size_t num_read = 0;
+        while (num_read < sizeof(bytes)) {
+            ssize_t ret = getrandom(bytes + num_read, sizeof(bytes) - num_read, 0);
+            if (ret < 0 && errno == EINTR) {
+                continue;
+            }
+            if (ret <= 0) {
+                LOG_F(ERROR, "[SessionTable] Read random bytes fail! Errno: %d", errno);
+                return "";
+            }
+            num_read += ret;
+        }
+        char token[33] = {0};
+        for (size_t i = 0; i < sizeof(bytes); i++) {
+            std::snprintf(token + 2 * i, 3, "%02x", bytes[i]);
+        }
+        return token;
+    }
+
+    std::string SessionTable::create(const std::string & user_name, const std::string & user_password) {
+        std::string token = make_token();
+        if (token.empty()) {
+            return token;
+        }
+        shard_t & shard = get_shard(token);
+        std::lock_guard<std::mutex> lock_guard(shard.lock);
+        shard.lru.push_front(session_t{token, user_name, user_password,
+            std::chrono::steady_clock::now() + ttl});
+        shard.sessions[token] = shard.lru.begin();
+        while ((long)shard.sessions.size() > max_shard_sessions) {
+            LOG_F(INFO, "[SessionTable] Evict session of %s", shard.lru.back().user_name.c_str());
+            shard.sessions.erase(shard.lru.back().token);
+            shard.lru.pop_back();
+        }
+        return token;
+    }
+
+    int SessionTable::check(const std::string & token, const std::string & user_name, const std::string & user_password) {
+        shard_t & shard = get_shard(token);
+        std::lock_guard<std::mutex> lock_guard(shard.lock);
+        auto iter = shard.sessions.find(token);
+        if (iter == shard.sessions.end()) {
+            return -1;
+        }
+        auto now = std::chrono::steady_clock::now();
+        session_t & session = *iter->second;
+        if (session.expire_time < now) {
+            shard.lru.erase(iter->second);
+            shard.sessions.erase(iter);
+            return -1;
+        }
+        if (session.user_name != user_name || session.user_password != user_password) {
+            return -1;
+        }
+        session.expire_time = now + ttl;
+        shard.lru.splice(shard.lru.begin(), shard.lru, iter->second);
+        return 0;
+    }
+
+    int SessionTable::erase(const std::string & token) {
+        shard_t & shard = get_shard(token);
+        std::lock_guard<std::mutex> lock_guard(shard.lock);
+        auto iter = shard.sessions.find(token);
+        if (iter == shard.sessions.end()) {
+            return -1;
+        }
+        shard.lru.erase(iter->second);
+        shard.sessions.erase(iter);
+        return 0;
+    }
+
+    int SessionTable::invalidate_user(const std::string & user_name) {
+        int num_erased = 0;
+        for (auto & shard : shards) {
+            std::lock_guard<std::mutex> lock_guard(shard->lock);
+            for (auto iter = shard->lru.begin(); iter != shard->lru.end();) {
+                if (iter->user_name == user_name) {
+                    shard->sessions.erase(iter->token);
+                    iter = shard->lru.erase(iter);
+                    num_erased++;
+                } else {
+                    iter++;
+                }
+            }
+        }
+        return num_erased;
+    }
+}
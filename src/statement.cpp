@@ -0,0 +1,125 @@
+#include "statement.h"
+
+namespace GLCC {
+    static std::string quote_string(const std::string & value) {
+        std::string literal;
+        literal.reserve(value.size() + 2);
+        literal.push_back('\'');
+        for (const char c : value) {
+            switch (c) {
+                case '\0': literal.append("\\0"); break;
+                case '\n': literal.append("\\n"); break;
+                case '\r': literal.append("\\r"); break;
+                case '\x1a': literal.append("\\Z"); break;
+                case '\\': literal.append("\\\\"); break;
+                case '\'': literal.append("\\'"); break;
+                case '"': literal.append("\\\""); break;
+                default: literal.push_back(c);
+            }
+        }
+        literal.push_back('\'');
+        return literal;
+    }
+
+    SqlParam::SqlParam(const std::string & value): value_literal(quote_string(value)) {}
+    SqlParam::SqlParam(const char * value): value_literal(quote_string(value)) {}
+    SqlParam::SqlParam(const int value): value_literal(std::to_string(value)) {}
+    SqlParam::SqlParam(const long value): value_literal(std::to_string(value)) {}
+    SqlParam::SqlParam(const long long value): value_literal(std::to_string(value)) {}
+
+    // calls on_placeholder with the offset of every ? outside quoted strings
+    template<typename Func_t>
+    static void scan_placeholders(const std::string & sql, Func_t on_placeholder) {
+        char quote = '\0';
+        for (size_t i = 0; i < sql.size(); i++) {
+            const char c = sql[i];
+            if (quote != '\0') {
+                if (c == '\\') {
+                    i++;
+                } else if (c == quote) {
+                    quote = '\0';
+                }
+            } else if (c == '\'' || c == '"' || c == '`') {
+                quote = c;
+            } else if (c == '?') {
+                on_placeholder(i);
+            }
+        }
+    }
+
+    int count_placeholders(const std::string & sql) noexcept {
+        int num_params = 0;
+        scan_placeholders(sql, [&](size_t) { num_params++; });
+        return num_params;
+    }
+
+    int bind_statement(const std::string & sql, const sql_params_t & params, std::string & query) {
+        size_t num_bound = 0, last = 0;
+        query.clear();
+        query.reserve(sql.size() + params.size() * 16);
+        scan_placeholders(sql, [&](size_t pos) {
+            query.append(sql, last, pos - last);
+            if (num_bound < params.size()) {
+                query.append(params[num_bound].literal());
+            }
+            num_bound++;
+            last = pos + 1;
+        });
+        query.append(sql, last, std::string::npos);
+        return num_bound == params.size() ? 0 : -1;
+    }
+
+    std::string sql_placeholders(const size_t num_params) {
+        std::string placeholders;
+        for (size_t i = 0; i < num_params; i++) {
+            placeholders += i == 0 ? "?" : ",?";
+        }
+        return placeholders;
+    }
+
+    int StatementCache::init(const std::string & url) {
+        std::lock_guard<std::mutex> lock_guard(lock);
+        this->url = url;
+        return 0;
+    }
+
+    int StatementCache::add(const std::string & name, const std::string & sql) {
+        std::lock_guard<std::mutex> lock_guard(lock);
+        if (statements.find(name) != statements.end()) {
+            LOG_F(ERROR, "[StatementCache] Statement %s exists!", name.c_str());
+            return -1;
+        }
+        statements[name] = statement_t{name, sql, count_placeholders(sql)};
+        return 0;
+    }
+
+    WFMySQLTask * StatementCache::create_task(const std::string & name, const sql_params_t & params, mysql_callback_t callback) {
+        statement_t statement;
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            auto iter = statements.find(name);
+            if (iter == statements.end()) {
+                LOG_F(ERROR, "[StatementCache] Find statement %s fail!", name.c_str());
+                return nullptr;
+            }
+            statement = iter->second;
+        }
+        if (statement.num_params != (int)params.size()) {
+            LOG_F(ERROR, "[StatementCache] Statement %s takes %d params, %d given!",
+                name.c_str(), statement.num_params, (int)params.size());
+            return nullptr;
+        }
+        return create_query_task(statement.sql, params, std::move(callback));
+    }
+
+    WFMySQLTask * StatementCache::create_query_task(const std::string & sql, const sql_params_t & params, mysql_callback_t callback) {
+        std::string query;
+        if (bind_statement(sql, params, query) == -1) {
+            LOG_F(ERROR, "[StatementCache] Query takes %d params, %d given!", count_placeholders(sql), (int)params.size());
+            return nullptr;
+        }
+        WFMySQLTask * task = WFTaskFactory::create_mysql_task(url, 0, std::move(callback));
+        task->get_req()->set_query(query);
+        return task;
+    }
+}
@@ -0,0 +1,145 @@
+#include "thumbnail.h"
+
+namespace GLCC {
+    int get_cover_path(const std::string & clip_path, std::string & cover_path) noexcept {
+        std::unordered_map<std::string, std::string> path_parse_results = {};
+        int ret = parse_path(clip_path, path_parse_results);
+        if (ret == -1) {
+            return -1;
+        }
+        cover_path = path_parse_results["dirname"] + "/" + path_parse_results["stem"] + "." + constants::cover_save_suffix;
+        return 0;
+    }
+
+    int write_cover(const std::string & cover_path, const cv::Mat & frame) noexcept {
+        std::vector<uchar> buffer;
+        if (frame.empty() || !cv::imencode("." + constants::cover_save_suffix, frame, buffer)) {
+            LOG_F(WARNING, "[Thumbnail] Encode cover %s fail!", cover_path.c_str());
+            return -1;
+        }
+        std::ofstream cover_file(cover_path, std::ios::binary);
+        cover_file.write((const char *)buffer.data(), buffer.size());
+        if (!cover_file) {
+            LOG_F(WARNING, "[Thumbnail] Write cover %s fail!", cover_path.c_str());
+            return -1;
+        }
+        return 0;
+    }
+
+    int ThumbnailService::init(const int num_workers, const size_t queue_size) {
+        std::lock_guard<std::mutex> lock_guard(lock);
+        if (!workers.empty()) {
+            return -1;
+        }
+        this->queue_size = queue_size > 0 ? queue_size : 1;
+        stopping = false;
+        for (int i = 0; i < std::max(num_workers, 1); i++) {
+            workers.emplace_back(&ThumbnailService::run, this);
+        }
+        LOG_F(INFO, "[Thumbnail] Start %d workers, queue size: %lu", std::max(num_workers, 1), (unsigned long)this->queue_size);
+        return 0;
+    }
+
+    void ThumbnailService::release() {
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            stopping = true;
+        }
+        cond.notify_all();
+        for (auto & worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+        for (auto & job : jobs) {
+            job->result.set_value(-1);
+        }
+        jobs.clear();
+        in_flight.clear();
+    }
+
+    int ThumbnailService::request(const std::string & clip_path, std::shared_future<int> * result) {
+        std::string cover_path;
+        if (get_cover_path(clip_path, cover_path) == -1) {
+            return THUMBNAIL_REJECT;
+        }
+        if (check_file(cover_path) >= 0) {
+            return THUMBNAIL_READY;
+        }
+        std::lock_guard<std::mutex> lock_guard(lock);
+        if (recording.count(clip_path)) {
+            return THUMBNAIL_RECORDING;
+        }
+        auto iter = in_flight.find(clip_path);
+        if (iter != in_flight.end()) {
+            if (result != nullptr) {
+                *result = iter->second;
+            }
+            return THUMBNAIL_PENDING;
+        }
+        if (stopping || workers.empty() || jobs.size() >= queue_size) {
+            return THUMBNAIL_REJECT;
+        }
+        std::unique_ptr<thumbnail_job_t> job(new thumbnail_job_t);
+        job->clip_path = clip_path;
+        job->cover_path = cover_path;
+        std::shared_future<int> job_result = job->result.get_future().share();
+        in_flight[clip_path] = job_result;
+        jobs.emplace_back(std::move(job));
+        cond.notify_one();
+        if (result != nullptr) {
+            *result = job_result;
+        }
+        return THUMBNAIL_PENDING;
+    }
+
+    void ThumbnailService::set_recording(const std::string & clip_path, const bool is_recording) {
+        std::lock_guard<std::mutex> lock_guard(lock);
+        if (is_recording) {
+            recording.insert(clip_path);
+        } else {
+            recording.erase(clip_path);
+        }
+    }
+
+    void ThumbnailService::run() {
+        for (;;) {
+            std::unique_ptr<thumbnail_job_t> job;
+            {
+                std::unique_lock<std::mutex> unique_lock(lock);
+                cond.wait(unique_lock, [this]() { return stopping || !jobs.empty(); });
+                if (stopping) {
+                    break;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            int ret = generate(job->clip_path, job->cover_path);
+            {
+                std::lock_guard<std::mutex> lock_guard(lock);
+                in_flight.erase(job->clip_path);
+            }
+            job->result.set_value(ret);
+        }
+    }
+
+    int ThumbnailService::generate(const std::string & clip_path, const std::string & cover_path) {
+        cv::VideoCapture capture;
+        if (!capture.open(clip_path)) {
+            LOG_F(WARNING, "[Thumbnail] Open %s fail!", clip_path.c_str());
+            return -1;
+        }
+        // the frame about 1s into the clip, or the first one of a shorter clip
+        cv::Mat frame;
+        capture.set(cv::CAP_PROP_POS_MSEC, 1000);
+        if (!capture.read(frame) || frame.empty()) {
+            capture.set(cv::CAP_PROP_POS_FRAMES, 0);
+            capture.read(frame);
+        }
+        capture.release();
+        int ret = write_cover(cover_path, frame);
+        if (ret == 0) {
+            LOG_F(INFO, "[Thumbnail] Create %s", cover_path.c_str());
+        }
+        return ret;
+    }
+}
@@ -0,0 +1,129 @@
+#include "transfer.h"
+
+namespace GLCC {
+    int parse_range(const std::string & range, const size_t size, size_t & start, size_t & end) noexcept {
+        static const std::string unit = "bytes=";
+        if (range.compare(0, unit.size(), unit) != 0) {
+            return RANGE_NONE;
+        }
+        std::string spec = range.substr(unit.size());
+        spec = spec.substr(0, spec.find(','));
+        size_t dash = spec.find('-');
+        if (dash == std::string::npos || size == 0) {
+            return RANGE_UNSATISFIABLE;
+        }
+        std::string first = spec.substr(0, dash);
+        std::string last = spec.substr(dash + 1);
+        char * parse_end = nullptr;
+        if (first.empty()) {
+            if (last.empty()) {
+                return RANGE_UNSATISFIABLE;
+            }
+            size_t suffix = std::strtoull(last.c_str(), &parse_end, 10);
+            if (*parse_end != '\0' || suffix == 0) {
+                return RANGE_UNSATISFIABLE;
+            }
+            start = suffix >= size ? 0 : size - suffix;
+            end = size - 1;
+            return RANGE_PARTIAL;
+        }
+        start = std::strtoull(first.c_str(), &parse_end, 10);
+        if (*parse_end != '\0' || start >= size) {
+            return RANGE_UNSATISFIABLE;
+        }
+        if (last.empty()) {
+            end = size - 1;
+        } else {
+            end = std::strtoull(last.c_str(), &parse_end, 10);
+            if (*parse_end != '\0' || end < start) {
+                return RANGE_UNSATISFIABLE;
+            }
+            end = std::min(end, size - 1);
+        }
+        return RANGE_PARTIAL;
+    }
+
+    std::string get_content_type(const std::string & path) noexcept {
+        static const std::unordered_map<std::string, std::string> content_types = {
+            {"mp4", "video/mp4"}, {"flv", "video/x-flv"}, {"avi", "video/x-msvideo"},
+            {"wmv", "video/x-ms-wmv"}, {"mpeg", "video/mpeg"}, {"jpg", "image/jpeg"},
+            {"jpeg", "image/jpeg"}, {"png", "image/png"}, {"json", "application/json"},
+        };
+        size_t dot = path.rfind('.');
+        if (dot != std::string::npos) {
+            std::string suffix = path.substr(dot + 1);
+            std::transform(suffix.begin(), suffix.end(), suffix.begin(), ::tolower);
+            auto iter = content_types.find(suffix);
+            if (iter != content_types.end()) {
+                return iter->second;
+            }
+        }
+        return "application/octet-stream";
+    }
+
+    std::string make_etag(const struct stat & st) noexcept {
+        char etag[64] = {0};
+        std::snprintf(etag, sizeof(etag), "\"%lx-%lx-%lx\"", (unsigned long)st.st_size,
+            (unsigned long)st.st_mtim.tv_sec, (unsigned long)st.st_mtim.tv_nsec);
+        return etag;
+    }
+
+    std::string make_http_date(const time_t time) noexcept {
+        char date[64] = {0};
+        struct tm gmt;
+        gmtime_r(&time, &gmt);
+        strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &gmt);
+        return date;
+    }
+
+    time_t parse_http_date(const std::string & date) noexcept {
+        struct tm gmt;
+        memset(&gmt, 0, sizeof(gmt));
+        const char * ret = strptime(date.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &gmt);
+        if (ret == nullptr) {
+            return -1;
+        }
+        return timegm(&gmt);
+    }
+
+    ChunkPool::ChunkPool(const size_t chunk_size, const size_t num_chunks):
+        chunk_size(chunk_size > 0 ? chunk_size : 1 << 20), num_chunks(num_chunks > 0 ? num_chunks : 1) {}
+
+    ChunkPool::~ChunkPool() {
+        for (auto chunk : free_chunks) {
+            free(chunk);
+        }
+    }
+
+    int ChunkPool::acquire(const size_t num, std::vector<void *> & chunks) {
+        std::lock_guard<std::mutex> lock_guard(lock);
+        if (num > free_chunks.size() + num_chunks - num_allocated) {
+            return -1;
+        }
+        for (size_t i = 0; i < num; i++) {
+            if (free_chunks.empty()) {
+                void * chunk = malloc(chunk_size);
+                if (chunk == nullptr) {
+                    break;
+                }
+                num_allocated++;
+                chunks.emplace_back(chunk);
+            } else {
+                chunks.emplace_back(free_chunks.back());
+                free_chunks.pop_back();
+            }
+        }
+        if (chunks.size() < num) {
+            free_chunks.insert(free_chunks.end(), chunks.begin(), chunks.end());
+            chunks.clear();
+            return -1;
+        }
+        return 0;
+    }
+
+    void ChunkPool::release(std::vector<void *> & chunks) {
+        std::lock_guard<std::mutex> lock_guard(lock);
+        free_chunks.insert(free_chunks.end(), chunks.begin(), chunks.end());
+        chunks.clear();
+    }
+}
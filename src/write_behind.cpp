@@ -0,0 +1,162 @@
+#include "write_behind.h"
+
+namespace GLCC {
+    static const int release_wait_second = 5;
+
+    int WriteBehind::init(const long flush_millisecond, const size_t max_batch_rows) {
+        std::lock_guard<std::mutex> lock_guard(lock);
+        this->flush_millisecond = std::max(flush_millisecond, 1L);
+        this->max_batch_rows = std::max(max_batch_rows, (size_t)1);
+        LOG_F(INFO, "[WriteBehind] Flush every %ld ms or %zu rows", this->flush_millisecond, this->max_batch_rows);
+        return 0;
+    }
+
+    void WriteBehind::release() {
+        std::vector<batch_t> pending;
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            is_released = true;
+            for (auto & iter : batches) {
+                take_pending(iter.second, pending);
+            }
+        }
+        flush(std::move(pending));
+        std::unique_lock<std::mutex> unique_lock(lock);
+        if (!flushed.wait_for(unique_lock, std::chrono::seconds(release_wait_second),
+                              [this]() { return num_in_flight == 0; })) {
+            LOG_F(WARNING, "[WriteBehind] %d batches still in flight at release", num_in_flight);
+        }
+    }
+
+    int WriteBehind::add(const std::string & name, const std::string & head, const std::string & item,
+                         const std::string & tail, const sql_params_t & head_params) {
+        std::string bound_head;
+        if (bind_statement(head, head_params, bound_head) == -1) {
+            LOG_F(ERROR, "[WriteBehind] Bind the head of %s fail!", name.c_str());
+            return -1;
+        }
+        std::lock_guard<std::mutex> lock_guard(lock);
+        if (batches.find(name) != batches.end()) {
+            LOG_F(ERROR, "[WriteBehind] Batch %s exists!", name.c_str());
+            return -1;
+        }
+        batch_t & batch = batches[name];
+        batch.name = name;
+        batch.head = bound_head;
+        batch.item = item;
+        batch.tail = tail;
+        batch.num_params = count_placeholders(item);
+        return 0;
+    }
+
+    int WriteBehind::push(const std::string & name, const sql_params_t & params, const std::string & tag) {
+        std::vector<batch_t> pending;
+        bool is_schedule = false;
+        {
+            std::lock_guard<std::mutex> lock_guard(lock);
+            auto iter = batches.find(name);
+            if (iter == batches.end()) {
+                LOG_F(ERROR, "[WriteBehind] Find batch %s fail!", name.c_str());
+                return -1;
+            }
+            batch_t & batch = iter->second;
+            if (batch.num_params != (int)params.size()) {
+                LOG_F(ERROR, "[WriteBehind] Batch %s takes %d params, %d given!",
+                    name.c_str(), batch.num_params, (int)params.size());
+                return -1;
+            }
+            batch.items.push_back(params);
+            batch.tags.push_back(tag);
+            if (batch.items.size() >= max_batch_rows || is_released) {
+                take_pending(batch, pending);
+            } else if (!is_timer_pending) {
+                is_timer_pending = true;
+                is_schedule = true;
+            }
+        }
+        flush(std::move(pending));
+        if (is_schedule) {
+            schedule_flush();
+        }
+        return 0;
+    }
+
+    void WriteBehind::take_pending(batch_t & batch, std::vector<batch_t> & pending) {
+        if (batch.items.empty()) {
+            return;
+        }
+        pending.emplace_back();
+        batch_t & taken = pending.back();
+        taken.name = batch.name;
+        taken.head = batch.head;
+        taken.item = batch.item;
+        taken.tail = batch.tail;
+        taken.num_params = batch.num_params;
+        taken.items.swap(batch.items);
+        taken.tags.swap(batch.tags);
+    }
+
+    void WriteBehind::schedule_flush() {
+        WFTimerTask * timer_task = WFTaskFactory::create_timer_task(
+            flush_millisecond / 1000, (flush_millisecond % 1000) * 1000000, [this](WFTimerTask * task) {
+                std::vector<batch_t> pending;
+                {
+                    std::lock_guard<std::mutex> lock_guard(lock);
+                    is_timer_pending = false;
+                    for (auto & iter : batches) {
+                        take_pending(iter.second, pending);
+                    }
+                }
+                flush(std::move(pending));
+            }
+        );
+        timer_task->start();
+    }
+
+    void WriteBehind::flush(std::vector<batch_t> && pending) {
+        for (auto & batch : pending) {
+            std::string sql = batch.head;
+            sql_params_t params;
+            params.reserve(batch.items.size() * batch.num_params);
+            for (size_t i = 0; i < batch.items.size(); i++) {
+                sql += i == 0 ? batch.item : "," + batch.item;
+                params.insert(params.end(), batch.items[i].begin(), batch.items[i].end());
+            }
+            sql += batch.tail;
+
+            const std::string name = batch.name;
+            const std::vector<std::string> tags = std::move(batch.tags);
+            WFMySQLTask * task = StatementCache::Instance().create_query_task(sql, params,
+                [this, name, tags](WFMySQLTask * task) {
+                    int state = task->get_state(); int error = task->get_error();
+                    protocol::MySQLResponse * resp = task->get_resp();
+                    if (state == WFT_STATE_SUCCESS && resp->get_packet_type() != MYSQL_PACKET_ERROR) {
+                        LOG_F(INFO, "[WriteBehind] Flush %d rows of %s success!", (int)tags.size(), name.c_str());
+                    } else {
+                        if (state == WFT_STATE_SUCCESS) {
+                            LOG_F(ERROR, "[WriteBehind] Flush %d rows of %s fail! Error_code=%d %s",
+                                (int)tags.size(), name.c_str(), resp->get_error_code(), resp->get_error_msg().c_str());
+                        } else {
+                            LOG_F(ERROR, "[WriteBehind] Flush %d rows of %s fail! Code: %d",
+                                (int)tags.size(), name.c_str(), error);
+                        }
+                        for (auto & tag : tags) {
+                            LOG_F(ERROR, "[WriteBehind][%s] Lost %s", name.c_str(), tag.c_str());
+                        }
+                    }
+                    std::lock_guard<std::mutex> lock_guard(lock);
+                    num_in_flight--;
+                    flushed.notify_all();
+                }
+            );
+            if (task == nullptr) {
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock_guard(lock);
+                num_in_flight++;
+            }
+            task->start();
+        }
+    }
+}